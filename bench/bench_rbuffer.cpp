@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "rbuffer.h"
+#include "spsc_rbuffer.h"
+#include "mpsc_rbuffer.h"
+
+using namespace std;
+
+// 对比SpscRBuffer/MpscRBuffer与mutex+RBuffer的吞吐，三者容量相同，满/空时各自按惯用方式阻塞。
+// 用法: bench_rbuffer [消息字节数] [每个生产者消息数] [MPSC生产者数]
+const size_t BENCH_RING_SIZE = 1024 * 64;
+const size_t BENCH_READ_SIZE = 1024 * 16;
+
+// 有界的mutex+RBuffer，满时生产者等待，空时消费者等待
+class MutexRBuffer
+{
+public:
+    MutexRBuffer(size_t size) : _buffer(size), _capacity(size) {;}
+
+    void set(const char* data, size_t size) {
+        unique_lock<mutex> lock(_mutex);
+        _writable.wait(lock, [&] {return _capacity - _buffer.used_size() >= size;});
+        _buffer.set(data, size);
+        _readable.notify_one();
+    }
+
+    size_t get(char* data, size_t size) {
+        unique_lock<mutex> lock(_mutex);
+        _readable.wait(lock, [&] {return _buffer.used_size() > 0;});
+        auto get_size = _buffer.get(data, size);
+        _writable.notify_all();
+        return get_size;
+    }
+
+private:
+    mutex   _mutex;
+    condition_variable  _readable;
+    condition_variable  _writable;
+    RBuffer _buffer;
+    size_t  _capacity;
+};
+
+struct BenchResult
+{
+    double  seconds;
+    size_t  bytes;
+};
+
+template<class Produce, class Consume>
+static BenchResult run_bench(int producer_count, size_t total, Produce produce, Consume consume)
+{
+    auto begin = chrono::steady_clock::now();
+    vector<thread> producers;
+    for (int i = 0; i < producer_count; i++) {
+        producers.emplace_back(produce);
+    }
+    vector<char> out(BENCH_READ_SIZE);
+    size_t bytes = 0;
+    while (bytes < total) {
+        bytes += consume(out.data(), out.size());
+    }
+    for (auto& item : producers) {
+        item.join();
+    }
+    chrono::duration<double> cost = chrono::steady_clock::now() - begin;
+    return {cost.count(), bytes};
+}
+
+static void report(const char* name, int producer_count, size_t msg_size, const BenchResult& result)
+{
+    auto msgs = result.bytes / msg_size;
+    printf("%-14s producers:%d msg:%zuB  %8.2f Mmsg/s  %8.1f MB/s\n", name, producer_count, msg_size,
+        msgs / result.seconds / 1e6, result.bytes / result.seconds / 1e6);
+}
+
+int main(int argc, char** argv)
+{
+    size_t msg_size = argc > 1 ? atoi(argv[1]) : 64;
+    size_t msg_count = argc > 2 ? atoi(argv[2]) : 2000000;
+    int mpsc_producers = argc > 3 ? atoi(argv[3]) : 4;
+    vector<char> msg(msg_size, 'x');
+    printf("hardware threads:%u\n", thread::hardware_concurrency());
+
+    {
+        SpscRBuffer ring(BENCH_RING_SIZE);
+        auto result = run_bench(1, msg_size * msg_count, [&]() {
+            for (size_t i = 0; i < msg_count; i++) {
+                while (!ring.set(msg.data(), msg_size)) {
+                    ring.wait_writable(msg_size);
+                }
+            }
+        }, [&](char* data, size_t size) {
+            auto n = ring.get(data, size);
+            if (n == 0) {
+                ring.wait_readable();
+            }
+            return n;
+        });
+        report("spsc", 1, msg_size, result);
+    }
+    {
+        MutexRBuffer buffer(BENCH_RING_SIZE);
+        auto result = run_bench(1, msg_size * msg_count, [&]() {
+            for (size_t i = 0; i < msg_count; i++) {
+                buffer.set(msg.data(), msg_size);
+            }
+        }, [&](char* data, size_t size) {
+            return buffer.get(data, size);
+        });
+        report("mutex+rbuffer", 1, msg_size, result);
+    }
+    {
+        MpscRBuffer ring(BENCH_RING_SIZE);
+        auto result = run_bench(mpsc_producers, msg_size * msg_count * mpsc_producers, [&]() {
+            for (size_t i = 0; i < msg_count; i++) {
+                while (!ring.set(msg.data(), msg_size)) {
+                    ring.wait_writable(msg_size);
+                }
+            }
+        }, [&](char* data, size_t size) {
+            auto n = ring.get(data, size);
+            if (n == 0) {
+                ring.wait_readable(10);
+            }
+            return n;
+        });
+        report("mpsc", mpsc_producers, msg_size, result);
+    }
+    {
+        MutexRBuffer buffer(BENCH_RING_SIZE);
+        auto result = run_bench(mpsc_producers, msg_size * msg_count * mpsc_producers, [&]() {
+            for (size_t i = 0; i < msg_count; i++) {
+                buffer.set(msg.data(), msg_size);
+            }
+        }, [&](char* data, size_t size) {
+            return buffer.get(data, size);
+        });
+        report("mutex+rbuffer", mpsc_producers, msg_size, result);
+    }
+    return 0;
+}
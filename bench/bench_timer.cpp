@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "timer.h"
+
+using namespace std;
+
+// Timer的set/cancel吞吐与单次耗时，分别使用内联存放(不超过48字节)和堆上存放的捕获。
+// 每次set后立即cancel，定时器不会到期，只测提交与取消路径。
+// 用法: bench_timer [线程数] [每线程set/cancel对数] [分片数]
+const int BENCH_SAMPLE_EVERY = 16;      // 每16次操作计时一次，减少取时开销对吞吐的影响
+
+struct Capture48
+{
+    atomic<long>* sum;
+    long values[5];
+};
+
+struct Capture96
+{
+    atomic<long>* sum;
+    long values[11];
+};
+
+struct BenchResult
+{
+    double  seconds;
+    vector<long>    set_ns;
+    vector<long>    cancel_ns;
+};
+
+template <class F>
+static BenchResult run_bench(Timer& timer, int thread_count, size_t count, F func)
+{
+    vector<vector<long>> set_ns(thread_count);
+    vector<vector<long>> cancel_ns(thread_count);
+    atomic<int> ready(0);
+    auto begin = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (int t = 0; t < thread_count; t++) {
+        threads.emplace_back([&, t]() {
+            set_ns[t].reserve(count / BENCH_SAMPLE_EVERY + 1);
+            cancel_ns[t].reserve(count / BENCH_SAMPLE_EVERY + 1);
+            ready++;
+            while (ready.load() < thread_count) {
+                this_thread::yield();
+            }
+            for (size_t i = 0; i < count; i++) {
+                if (i % BENCH_SAMPLE_EVERY) {
+                    timer.cancel(timer.set(60000, func));
+                    continue ;
+                }
+                auto t0 = chrono::steady_clock::now();
+                auto id = timer.set(60000, func);
+                auto t1 = chrono::steady_clock::now();
+                timer.cancel(id);
+                auto t2 = chrono::steady_clock::now();
+                set_ns[t].push_back(chrono::duration_cast<chrono::nanoseconds>(t1 - t0).count());
+                cancel_ns[t].push_back(chrono::duration_cast<chrono::nanoseconds>(t2 - t1).count());
+            }
+        });
+    }
+    for (auto& item : threads) {
+        item.join();
+    }
+    chrono::duration<double> cost = chrono::steady_clock::now() - begin;
+    BenchResult result;
+    result.seconds = cost.count();
+    for (int t = 0; t < thread_count; t++) {
+        result.set_ns.insert(result.set_ns.end(), set_ns[t].begin(), set_ns[t].end());
+        result.cancel_ns.insert(result.cancel_ns.end(), cancel_ns[t].begin(), cancel_ns[t].end());
+    }
+    return result;
+}
+
+static long percentile(vector<long>& samples, double p)
+{
+    if (samples.empty()) {
+        return 0;
+    }
+    auto index = (size_t)(p * (samples.size() - 1));
+    nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+
+static void report(const char* name, int thread_count, size_t count, BenchResult& result)
+{
+    auto pairs = count * thread_count;
+    printf("%-10s threads:%d  %7.2f Mpair/s", name, thread_count, pairs / result.seconds / 1e6);
+    printf("  set p50/p99/p999:%ld/%ld/%ldns", percentile(result.set_ns, 0.5),
+        percentile(result.set_ns, 0.99), percentile(result.set_ns, 0.999));
+    printf("  cancel p50/p99/p999:%ld/%ld/%ldns\n", percentile(result.cancel_ns, 0.5),
+        percentile(result.cancel_ns, 0.99), percentile(result.cancel_ns, 0.999));
+}
+
+int main(int argc, char** argv)
+{
+    int thread_count = argc > 1 ? atoi(argv[1]) : 4;
+    size_t count = argc > 2 ? atoi(argv[2]) : 1000000;
+    size_t shard_count = argc > 3 ? atoi(argv[3]) : 8;
+    printf("hardware threads:%u\n", thread::hardware_concurrency());
+
+    atomic<long> sum(0);
+    Capture48 small_capture = {&sum, {1, 2, 3, 4, 5}};
+    auto small = [small_capture]() {*small_capture.sum += small_capture.values[0];};
+    static_assert(sizeof(small) <= 48, "capture is not inline");
+    Capture96 large_capture = {&sum, {1}};
+    auto large = [large_capture]() {*large_capture.sum += large_capture.values[0];};
+    static_assert(sizeof(large) > 48, "capture fits inline");
+
+    for (auto threads : {1, thread_count}) {
+        {
+            Timer timer(1, shard_count);
+            timer.init(1);
+            // 预热：slab扩容
+            run_bench(timer, threads, count / 10, small);
+            auto result = run_bench(timer, threads, count, small);
+            report("inline48", threads, count, result);
+        }
+        {
+            Timer timer(1, shard_count);
+            timer.init(1);
+            run_bench(timer, threads, count / 10, large);
+            auto result = run_bench(timer, threads, count, large);
+            report("heap96", threads, count, result);
+        }
+        if (thread_count == 1) {
+            break ;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,277 @@
+#ifndef __BINARY_STREAM_H__
+#define __BINARY_STREAM_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "buffer.h"
+
+using namespace std;
+
+// 按模板参数指定的字节序读写定长整数，与主机序一致时退化为memcpy
+template <bool BIG>
+struct BinaryOrder
+{
+    template <class T>
+    static T load(const char* p) {
+        static_assert(is_unsigned<T>::value, "unsigned integer only");
+        T v;
+        memcpy(&v, p, sizeof(T));
+        return swap(v);
+    }
+
+    template <class T>
+    static void store(char* p, T v) {
+        static_assert(is_unsigned<T>::value, "unsigned integer only");
+        v = swap(v);
+        memcpy(p, &v, sizeof(T));
+    }
+
+    template <class T>
+    static T swap(T v) {
+        if ((__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__) == BIG || sizeof(T) == 1) {
+            return v;
+        }
+        if (sizeof(T) == 2) {
+            return (T)__builtin_bswap16((uint16_t)v);
+        }
+        if (sizeof(T) == 4) {
+            return (T)__builtin_bswap32((uint32_t)v);
+        }
+        return (T)__builtin_bswap64((uint64_t)v);
+    }
+};
+
+// 直接编码进Buffer尾部可写空间：每次写入只比较一次剩余空间，不足时才扩容，
+// 数据在flush或析构时一次commit。写入期间不得读取或以其他方式写入该Buffer
+template <bool BIG = true>
+class BufferWriter
+{
+public:
+    // size_hint为预计写入的总字节数，一次预留后后续写入不再扩容
+    BufferWriter(Buffer& buffer, size_t size_hint = 0) : _buffer(buffer) {
+        _buffer.reserve(size_hint);
+        _ptr = _buffer.write_ptr();
+        _end = _ptr + _buffer.writable_size();
+    }
+
+    ~BufferWriter() {
+        flush();
+    }
+
+    BufferWriter(const BufferWriter&) = delete;
+    BufferWriter& operator=(const BufferWriter&) = delete;
+
+    void write_u8(uint8_t v) {write_int(v);}
+    void write_u16(uint16_t v) {write_int(v);}
+    void write_u32(uint32_t v) {write_int(v);}
+    void write_u64(uint64_t v) {write_int(v);}
+
+    // LEB128，最多10字节
+    void write_varint(uint64_t v) {
+        ensure(VARINT_MAX_BYTES);
+        while (v >= 0x80) {
+            *_ptr++ = (char)(v | 0x80);
+            v >>= 7;
+        }
+        *_ptr++ = (char)v;
+    }
+
+    void write_bytes(const char* data, size_t size) {
+        ensure(size);
+        memcpy(_ptr, data, size);
+        _ptr += size;
+    }
+
+    void write_bytes(string_view data) {
+        write_bytes(data.data(), data.size());
+    }
+
+    // 预留长度字段并返回其位置，内容写完后以patch_*回填
+    size_t reserve_u16() {return reserve_int<uint16_t>();}
+    size_t reserve_u32() {return reserve_int<uint32_t>();}
+    size_t reserve_u64() {return reserve_int<uint64_t>();}
+
+    void patch_u16(size_t pos, uint16_t v) {patch_int(pos, v);}
+    void patch_u32(size_t pos, uint32_t v) {patch_int(pos, v);}
+    void patch_u64(size_t pos, uint64_t v) {patch_int(pos, v);}
+
+    // 当前写入位置，与reserve_*返回值同一坐标，相减即为其后写入的字节数
+    size_t position() {
+        return _buffer.used_size() + (_ptr - _buffer.write_ptr());
+    }
+
+    // 提交已写入的数据
+    void flush() {
+        _buffer.commit(_ptr - _buffer.write_ptr());
+        _ptr = _buffer.write_ptr();
+    }
+
+private:
+    enum {
+        VARINT_MAX_BYTES = 10,
+    };
+
+    void ensure(size_t size) {
+        if ((size_t)(_end - _ptr) >= size) {
+            return ;
+        }
+        // 扩容可能移动或重新分配内存，先提交已写入部分
+        flush();
+        _buffer.reserve(size);
+        _ptr = _buffer.write_ptr();
+        _end = _ptr + _buffer.writable_size();
+    }
+
+    template <class T>
+    void write_int(T v) {
+        ensure(sizeof(T));
+        BinaryOrder<BIG>::store(_ptr, v);
+        _ptr += sizeof(T);
+    }
+
+    template <class T>
+    size_t reserve_int() {
+        ensure(sizeof(T));
+        auto pos = position();
+        _ptr += sizeof(T);
+        return pos;
+    }
+
+    // 位置相对Buffer可读数据起点，扩容move后仍有效
+    template <class T>
+    void patch_int(size_t pos, T v) {
+        BinaryOrder<BIG>::store((char*)_buffer.data() + pos, v);
+    }
+
+private:
+    Buffer& _buffer;
+    char*   _ptr;
+    char*   _end;
+};
+
+// 从连续内存解码，可直接作用于Buffer::data()、MirrorRBuffer::read_ptr()或分帧得到的string_view，
+// 不拷贝不分配。越界时返回false且不移动读位置
+template <bool BIG = true>
+class BufferReader
+{
+public:
+    BufferReader(const char* data, size_t size) {
+        _begin = data;
+        _ptr = data;
+        _end = data + size;
+    }
+
+    BufferReader(string_view data) : BufferReader(data.data(), data.size()) {}
+
+    // 读完后以buffer.skip(reader.consumed())消费
+    BufferReader(Buffer& buffer) : BufferReader(buffer.data(), buffer.used_size()) {}
+
+    bool read_u8(uint8_t& v) {return read_int(v);}
+    bool read_u16(uint16_t& v) {return read_int(v);}
+    bool read_u32(uint32_t& v) {return read_int(v);}
+    bool read_u64(uint64_t& v) {return read_int(v);}
+
+    bool peek_u8(uint8_t& v) {return peek_int(v);}
+    bool peek_u16(uint16_t& v) {return peek_int(v);}
+    bool peek_u32(uint32_t& v) {return peek_int(v);}
+    bool peek_u64(uint64_t& v) {return peek_int(v);}
+
+    bool read_varint(uint64_t& v) {
+        size_t len;
+        if (!decode_varint(v, len)) {
+            return false;
+        }
+        _ptr += len;
+        return true;
+    }
+
+    bool peek_varint(uint64_t& v) {
+        size_t len;
+        return decode_varint(v, len);
+    }
+
+    bool read_bytes(char* data, size_t size) {
+        if (remaining() < size) {
+            return false;
+        }
+        memcpy(data, _ptr, size);
+        _ptr += size;
+        return true;
+    }
+
+    // 返回指向原数据的视图，生命期同底层内存
+    bool read_view(string_view& data, size_t size) {
+        if (remaining() < size) {
+            return false;
+        }
+        data = string_view(_ptr, size);
+        _ptr += size;
+        return true;
+    }
+
+    bool skip(size_t size) {
+        if (remaining() < size) {
+            return false;
+        }
+        _ptr += size;
+        return true;
+    }
+
+    size_t remaining() {
+        return _end - _ptr;
+    }
+
+    size_t consumed() {
+        return _ptr - _begin;
+    }
+
+private:
+    enum {
+        VARINT_MAX_BYTES = 10,
+    };
+
+    template <class T>
+    bool peek_int(T& v) {
+        if (remaining() < sizeof(T)) {
+            return false;
+        }
+        v = BinaryOrder<BIG>::template load<T>(_ptr);
+        return true;
+    }
+
+    template <class T>
+    bool read_int(T& v) {
+        if (!peek_int(v)) {
+            return false;
+        }
+        _ptr += sizeof(T);
+        return true;
+    }
+
+    // 数据不足或超过10字节均返回false
+    bool decode_varint(uint64_t& v, size_t& len) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < VARINT_MAX_BYTES && i < remaining(); i++) {
+            auto b = (unsigned char)_ptr[i];
+            value |= (uint64_t)(b & 0x7f) << (7 * i);
+            if (!(b & 0x80)) {
+                v = value;
+                len = i + 1;
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    const char* _begin;
+    const char* _ptr;
+    const char* _end;
+};
+
+#endif
@@ -0,0 +1,234 @@
+#ifndef __BLOCK_POOL_H__
+#define __BLOCK_POOL_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <stdexcept>
+
+using namespace std;
+
+// 定长网络缓冲block池：每个线程持有有界的空闲链表，命中时不加锁也不进入系统分配器；
+// 线程缓存溢出或耗尽时与全局depot按批转移，depot为空时从arena切分新block。
+// arena不归还系统，常驻内存以峰值为上限
+class BlockPool
+{
+public:
+    enum {
+        BLOCK_SIZE  = 1024 * 16,
+        ARENA_SIZE  = 1024 * 1024 * 2,
+        BATCH_SIZE  = 32,       // 线程缓存与depot之间一次转移的block数
+        CACHE_LIMIT = 128,      // 线程缓存上限，超出时归还一批
+    };
+
+    struct Stats
+    {
+        uint64_t    alloc_count;
+        uint64_t    cache_hits;         // 线程缓存直接命中的次数
+        uint64_t    depot_fetches;
+        uint64_t    depot_returns;
+        uint64_t    arena_count;
+        size_t      resident_bytes;     // arena占用的总内存
+        size_t      depot_blocks;
+
+        double hit_rate() {
+            return alloc_count ? (double)cache_hits / alloc_count : 0;
+        }
+    };
+
+    // 进程级单例，有意不析构，保证线程退出时归还的block仍有去处
+    static BlockPool& instance() {
+        static BlockPool* pool = new BlockPool;
+        return *pool;
+    }
+
+    // 首次分配前调用，arena优先使用2MB大页，失败时退回普通页并madvise
+    void set_hugepage(bool on) {_hugepage = on;}
+
+    void* alloc() {
+        auto& cache = local_cache();
+        cache.alloc_count++;
+        if (cache.head) {
+            cache.hit_count++;
+        } else {
+            refill(cache);
+        }
+        auto node = cache.head;
+        cache.head = node->next;
+        cache.count--;
+        return node;
+    }
+
+    void free(void* block) {
+        auto& cache = local_cache();
+        auto node = (FreeNode*)block;
+        node->next = cache.head;
+        cache.head = node;
+        cache.count++;
+        if (cache.count > CACHE_LIMIT) {
+            spill(cache, BATCH_SIZE);
+        }
+    }
+
+    // 各线程的命中计数在与depot交互时汇总，结果为近似值
+    Stats get_stats() {
+        Stats stats;
+        stats.alloc_count = _alloc_count.load(memory_order_relaxed);
+        stats.cache_hits = _hit_count.load(memory_order_relaxed);
+        stats.depot_fetches = _depot_fetches.load(memory_order_relaxed);
+        stats.depot_returns = _depot_returns.load(memory_order_relaxed);
+        stats.arena_count = _arena_count.load(memory_order_relaxed);
+        stats.resident_bytes = stats.arena_count * ARENA_SIZE;
+        lock_guard<mutex> lock(_mutex);
+        stats.depot_blocks = 0;
+        for (auto& item : _depot) {
+            stats.depot_blocks += item.count;
+        }
+        return stats;
+    }
+
+private:
+    struct FreeNode
+    {
+        FreeNode*   next;
+    };
+
+    struct Batch
+    {
+        FreeNode*   head;
+        int         count;
+    };
+
+    struct Cache
+    {
+        FreeNode*   head = NULL;
+        int         count = 0;
+        uint64_t    alloc_count = 0;
+        uint64_t    hit_count = 0;
+
+        // 线程退出时归还全部缓存
+        ~Cache() {
+            auto& pool = BlockPool::instance();
+            pool.flush_stats(*this);
+            if (count > 0) {
+                pool.spill(*this, count);
+            }
+        }
+    };
+
+    BlockPool() {
+        _hugepage = false;
+        _alloc_count = 0;
+        _hit_count = 0;
+        _depot_fetches = 0;
+        _depot_returns = 0;
+        _arena_count = 0;
+    }
+
+    static Cache& local_cache() {
+        static thread_local Cache cache;
+        return cache;
+    }
+
+    void flush_stats(Cache& cache) {
+        _alloc_count.fetch_add(cache.alloc_count, memory_order_relaxed);
+        _hit_count.fetch_add(cache.hit_count, memory_order_relaxed);
+        cache.alloc_count = 0;
+        cache.hit_count = 0;
+    }
+
+    void refill(Cache& cache) {
+        flush_stats(cache);
+        {
+            lock_guard<mutex> lock(_mutex);
+            if (!_depot.empty()) {
+                auto batch = _depot.back();
+                _depot.pop_back();
+                cache.head = batch.head;
+                cache.count = batch.count;
+                _depot_fetches.fetch_add(1, memory_order_relaxed);
+                return ;
+            }
+        }
+
+        // depot为空，切分一个新arena：第一批留给本线程，其余放入depot
+        auto arena = alloc_arena();
+        int count = ARENA_SIZE / BLOCK_SIZE;
+        vector<Batch> batches;
+        Batch batch = {NULL, 0};
+        for (int i = count - 1; i >= 0; i--) {
+            auto node = (FreeNode*)(arena + (size_t)i * BLOCK_SIZE);
+            node->next = batch.head;
+            batch.head = node;
+            batch.count++;
+            if (batch.count == BATCH_SIZE || i == 0) {
+                batches.push_back(batch);
+                batch = {NULL, 0};
+            }
+        }
+        cache.head = batches.back().head;
+        cache.count = batches.back().count;
+        batches.pop_back();
+
+        lock_guard<mutex> lock(_mutex);
+        _depot.insert(_depot.end(), batches.begin(), batches.end());
+    }
+
+    void spill(Cache& cache, int count) {
+        Batch batch = {cache.head, 0};
+        FreeNode* last = NULL;
+        while (batch.count < count && cache.head) {
+            last = cache.head;
+            cache.head = cache.head->next;
+            batch.count++;
+        }
+        if (!last) {
+            return ;
+        }
+        last->next = NULL;
+        cache.count -= batch.count;
+        flush_stats(cache);
+        _depot_returns.fetch_add(1, memory_order_relaxed);
+
+        lock_guard<mutex> lock(_mutex);
+        _depot.push_back(batch);
+    }
+
+    char* alloc_arena() {
+        void* ptr = MAP_FAILED;
+        if (_hugepage) {
+            ptr = mmap(NULL, ARENA_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        }
+        if (ptr == MAP_FAILED) {
+            ptr = mmap(NULL, ARENA_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (ptr == MAP_FAILED) {
+                throw runtime_error("mmap fail");
+            }
+            if (_hugepage) {
+                madvise(ptr, ARENA_SIZE, MADV_HUGEPAGE);
+            }
+        }
+        _arena_count.fetch_add(1, memory_order_relaxed);
+        return (char*)ptr;
+    }
+
+private:
+    bool    _hugepage;
+
+    mutex           _mutex;
+    vector<Batch>   _depot;
+
+    atomic<uint64_t>    _alloc_count;
+    atomic<uint64_t>    _hit_count;
+    atomic<uint64_t>    _depot_fetches;
+    atomic<uint64_t>    _depot_returns;
+    atomic<uint64_t>    _arena_count;
+};
+
+#endif
@@ -14,7 +14,8 @@ public:
     Buffer(size_t size) {
         _r_pos = 0;
         _w_pos = 0;
-        _buffer = (char*)malloc(size);
+        _size = size > 0 ? size : 1;
+        _buffer = (char*)malloc(_size);
         if (!_buffer) {
             throw runtime_error("malloc fail");
         }
@@ -31,19 +32,19 @@ public:
     }
 
     void set(const char* data, size_t size) {
-        if (_w_pos + size > size()) {
+        if (_w_pos + size > _size) {
             move();
         }
-        if (used_size() + size > size()) {
-            grow();
+        if (used_size() + size > _size) {
+            grow(size);
         }
-        memcpy(_buffer + _w_buf, data, size);
-        _w_buf += size;
+        memcpy(_buffer + _w_pos, data, size);
+        _w_pos += size;
     }
 
     size_t get(char* data, size_t size) {
-        auto ret = get(data, size);
-        _r_pos += ret;
+        auto ret = pick(data, size);
+        skip(ret);
         return ret;
     }
 
@@ -60,15 +61,44 @@ public:
         if (skip_size > 0) {
             _r_pos += skip_size;
         }
+        // 读空后回到起点，后续写入不必move
+        if (_r_pos == _w_pos) {
+            _r_pos = 0;
+            _w_pos = 0;
+        }
         return skip_size;
     }
 
+    // 保证尾部至少有size字节连续可写空间，供recv/readv直接写入
+    void reserve(size_t size) {
+        if (writable_size() >= size) {
+            return ;
+        }
+        move();
+        if (writable_size() < size) {
+            grow(size);
+        }
+    }
+
+    char* write_ptr() {
+        return _buffer + _w_pos;
+    }
+
+    size_t writable_size() {
+        return _size - _w_pos;
+    }
+
+    // 确认直接写入write_ptr()的size字节
+    void commit(size_t size) {
+        _w_pos += size;
+    }
+
     const char* data() {
         return _buffer + _r_pos;
     }
 
     size_t size() {
-        return _data.size();
+        return _size;
     }
 
     size_t used_size() {
@@ -84,7 +114,7 @@ private:
         if (_r_pos == 0) {
             return ;
         }
-        memmove(_buffer, _buffer + _r_pos, _r_pos);
+        memmove(_buffer, _buffer + _r_pos, used_size());
         _w_pos -= _r_pos;
         _r_pos = 0;
     }
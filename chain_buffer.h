@@ -0,0 +1,326 @@
+#ifndef __CHAIN_BUFFER_H__
+#define __CHAIN_BUFFER_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <stdexcept>
+
+#include "block_pool.h"
+
+using namespace std;
+
+// 由定长block串成的缓冲区，追加与消费均为O(1)，扩容只追加block，不拷贝已有数据。
+// 默认block恰好占用一个BlockPool单元，由线程缓存分配；其他大小的block走malloc
+class ChainBuffer
+{
+public:
+    // block_size为每个block的数据容量，0表示按BlockPool单元大小
+    ChainBuffer(size_t block_size = 0) {
+        _block_size = block_size > 0 ? block_size : pool_capacity();
+        _head = NULL;
+        _tail = NULL;
+        _used_size = 0;
+        _capacity = 0;
+        _block_count = 0;
+        _w_block = NULL;
+    }
+
+    ~ChainBuffer() {
+        clear();
+    }
+
+    ChainBuffer(const ChainBuffer&) = delete;
+    ChainBuffer& operator=(const ChainBuffer&) = delete;
+
+    void set(const char* data, size_t size) {
+        while (size > 0) {
+            if (!_tail || _tail->w == _tail->cap) {
+                push_block(alloc_block(_block_size));
+            }
+            auto n = _tail->cap - _tail->w;
+            if (n > size) {
+                n = size;
+            }
+            memcpy(_tail->data + _tail->w, data, n);
+            _tail->w += n;
+            _used_size += n;
+            data += n;
+            size -= n;
+        }
+    }
+
+    size_t get(char* data, size_t size) {
+        auto ret = pick(data, size);
+        skip(ret);
+        return ret;
+    }
+
+    // 跨block拷贝，不消费
+    size_t pick(char* data, size_t size) {
+        size_t get_size = 0;
+        for (auto block = _head; block && get_size < size; block = block->next) {
+            auto n = block->w - block->r;
+            if (n > size - get_size) {
+                n = size - get_size;
+            }
+            memcpy(data + get_size, block->data + block->r, n);
+            get_size += n;
+        }
+        return get_size;
+    }
+
+    // 读空的block立即释放
+    size_t skip(size_t size) {
+        size_t skip_size = 0;
+        drop_empty_front();
+        while (_head && skip_size < size) {
+            auto n = _head->w - _head->r;
+            if (n > size - skip_size) {
+                n = size - skip_size;
+            }
+            _head->r += n;
+            skip_size += n;
+            if (_head->r == _head->w) {
+                if (_head == _tail && _head->cap == _block_size) {
+                    // 最后一个常规block保留复用，超大block读空即释放
+                    _head->r = _head->w = 0;
+                    break ;
+                }
+                pop_block();
+            }
+        }
+        _used_size -= skip_size;
+        return skip_size;
+    }
+
+    // 首个block中连续可读的数据
+    const char* data() {
+        drop_empty_front();
+        return _head ? _head->data + _head->r : NULL;
+    }
+
+    size_t front_size() {
+        drop_empty_front();
+        return _head ? _head->w - _head->r : 0;
+    }
+
+    size_t used_size() {
+        return _used_size;
+    }
+
+    size_t block_count() {
+        return _block_count;
+    }
+
+    // 所有block占用的内存，含block头
+    size_t capacity() {
+        return _capacity;
+    }
+
+    // 读空时释放全部block
+    void release() {
+        if (_used_size == 0) {
+            clear();
+        }
+    }
+
+    // 使前size字节连续并返回其地址。新block预留同等余量，
+    // 大帧分多次到达时后续数据直接写入余量，合并拷贝总量与帧长成线性
+    const char* pullup(size_t size) {
+        if (size > _used_size) {
+            size = _used_size;
+        }
+        if (!_head || front_size() >= size) {
+            return data();
+        }
+        auto block = alloc_block(size * 2 > _block_size ? size * 2 : _block_size);
+        pick(block->data, size);
+        block->w = size;
+        skip(size);
+        if (_used_size == 0) {
+            // 数据已全部合并，原有的空block一并释放
+            while (_head) {
+                pop_block();
+            }
+        }
+        block->next = _head;
+        _head = block;
+        if (!_tail) {
+            _tail = block;
+        }
+        _block_count++;
+        _capacity += sizeof(Block) + block->cap;
+        _used_size += size;
+        return data();
+    }
+
+    // 保证尾部block至少有size字节连续可写空间，不足时追加新block
+    void reserve(size_t size) {
+        if (_tail && _tail->cap - _tail->w >= size) {
+            return ;
+        }
+        // 唯一且为空的block容量不足时直接替换，保证首个block不为空
+        if (_tail && _head == _tail && _tail->r == _tail->w) {
+            pop_block();
+        }
+        push_block(alloc_block(size > _block_size ? size : _block_size));
+    }
+
+    char* write_ptr() {
+        return _tail ? _tail->data + _tail->w : NULL;
+    }
+
+    size_t writable_size() {
+        return _tail ? _tail->cap - _tail->w : 0;
+    }
+
+    // 确认直接写入write_ptr()的size字节
+    void commit(size_t size) {
+        _tail->w += size;
+        _used_size += size;
+    }
+
+    // 导出可读区域供writev，返回填充的iovec个数
+    int read_iov(struct iovec* iov, int max) {
+        int count = 0;
+        for (auto block = _head; block && count < max; block = block->next) {
+            if (block->w == block->r) {
+                continue ;
+            }
+            iov[count].iov_base = block->data + block->r;
+            iov[count].iov_len = block->w - block->r;
+            count++;
+        }
+        return count;
+    }
+
+    // 导出至少size字节的可写区域供readv，读入后以commit_iov确认
+    int write_iov(struct iovec* iov, int max, size_t size) {
+        size_t total = 0;
+        int count = 0;
+        auto block = _tail;
+        _w_block = NULL;
+        if (block && block->cap > block->w && max > 0) {
+            iov[count].iov_base = block->data + block->w;
+            iov[count].iov_len = block->cap - block->w;
+            total += iov[count].iov_len;
+            count++;
+            _w_block = block;
+        }
+        while (total < size && count < max) {
+            push_block(alloc_block(_block_size));
+            if (!_w_block) {
+                _w_block = _tail;
+            }
+            iov[count].iov_base = _tail->data;
+            iov[count].iov_len = _tail->cap;
+            total += _tail->cap;
+            count++;
+        }
+        return count;
+    }
+
+    void commit_iov(size_t size) {
+        // 从write_iov导出的第一个block开始顺序填充
+        auto block = _w_block;
+        while (block && size > 0) {
+            auto n = block->cap - block->w;
+            if (n > size) {
+                n = size;
+            }
+            block->w += n;
+            _used_size += n;
+            size -= n;
+            block = block->next;
+        }
+    }
+
+    void clear() {
+        while (_head) {
+            pop_block();
+        }
+        _used_size = 0;
+    }
+
+private:
+    // write_iov未写满或reserve追加的空block可能夹在数据之间，读取前跳过
+    void drop_empty_front() {
+        while (_head && _head != _tail && _head->r == _head->w) {
+            pop_block();
+        }
+    }
+
+    struct Block
+    {
+        Block*  next;
+        size_t  cap;
+        size_t  r;
+        size_t  w;
+        char    data[0];
+    };
+
+    static size_t pool_capacity() {
+        return BlockPool::BLOCK_SIZE - sizeof(Block);
+    }
+
+    Block* alloc_block(size_t cap) {
+        Block* block;
+        if (cap == pool_capacity()) {
+            block = (Block*)BlockPool::instance().alloc();
+        } else {
+            block = (Block*)malloc(sizeof(Block) + cap);
+            if (!block) {
+                throw runtime_error("malloc fail");
+            }
+        }
+        block->next = NULL;
+        block->cap = cap;
+        block->r = 0;
+        block->w = 0;
+        return block;
+    }
+
+    void push_block(Block* block) {
+        if (_tail) {
+            _tail->next = block;
+        } else {
+            _head = block;
+        }
+        _tail = block;
+        _block_count++;
+        _capacity += sizeof(Block) + block->cap;
+    }
+
+    void pop_block() {
+        auto block = _head;
+        if (block == _w_block) {
+            _w_block = NULL;
+        }
+        _head = block->next;
+        if (!_head) {
+            _tail = NULL;
+        }
+        _block_count--;
+        _capacity -= sizeof(Block) + block->cap;
+        if (block->cap == pool_capacity()) {
+            BlockPool::instance().free(block);
+        } else {
+            free(block);
+        }
+    }
+
+private:
+    size_t  _block_size;
+    size_t  _used_size;
+    size_t  _capacity;
+    size_t  _block_count;
+    Block*  _head;
+    Block*  _tail;
+
+    // 最近一次write_iov的起始block
+    Block*  _w_block;
+};
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef __COMMON_UTILS_H__
 #define __COMMON_UTILS_H__
 
+#include <time.h>
 #include <sys/time.h>
 #include <sys/syscall.h>
 
@@ -34,6 +35,7 @@ public:
         return time(0); 
     }
 
+    // 墙上时间，会随NTP校时跳变，计算时间间隔和超时应使用monotonic_*
     inline static long now_ms()
     {
         struct timeval tv; 
@@ -41,6 +43,30 @@ public:
         return tv.tv_sec * 1000 + tv.tv_usec / 1000;
     }
 
+    inline static long monotonic_us()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+    }
+
+    inline static long monotonic_ns()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000000L + ts.tv_nsec;
+    }
+
+    // 自旋等待时降低功耗并让出超线程
+    inline static void cpu_relax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield" ::: "memory");
+#endif
+    }
+
     inline static int gettid()
     {
         return syscall(SYS_gettid); 
@@ -0,0 +1,88 @@
+#ifndef __EPOLL_BALANCER_H__
+#define __EPOLL_BALANCER_H__
+
+#include <atomic>
+
+#include "epoll_executor.h"
+
+using namespace std;
+
+// 新连接的loop选择策略，由EpollChannelServer的内置acceptor调用
+class EpollBalancer
+{
+public:
+	virtual ~EpollBalancer() {;}
+
+	// local_index为执行accept的loop
+	virtual int select(EpollEngine& engine, int local_index) = 0;
+};
+
+// 留在accept所在loop，适合reuseport模式下已由内核分流的场景
+class EpollBalancerLocal : public EpollBalancer
+{
+public:
+	int select(EpollEngine& /*engine*/, int local_index) {
+		return local_index;
+	}
+};
+
+class EpollBalancerRoundRobin : public EpollBalancer
+{
+public:
+	EpollBalancerRoundRobin() {
+		_next = 0;
+	}
+
+	int select(EpollEngine& engine, int /*local_index*/) {
+		return (int)(_next.fetch_add(1, memory_order_relaxed) % (unsigned)engine.get_thread_count());
+	}
+
+private:
+	atomic<unsigned>	_next;
+};
+
+class EpollBalancerLeastConn : public EpollBalancer
+{
+public:
+	int select(EpollEngine& engine, int local_index) {
+		int index = local_index;
+		int min_load = engine.get_loop_load(local_index);
+		for (int i = 0; i < engine.get_thread_count(); i++) {
+			auto load = engine.get_loop_load(i);
+			if (load < min_load) {
+				min_load = load;
+				index = i;
+			}
+		}
+		return index;
+	}
+};
+
+// power of two choices：随机取两个loop选负载低者，O(1)且避免所有acceptor同时涌向同一个最小值
+class EpollBalancerP2C : public EpollBalancer
+{
+public:
+	int select(EpollEngine& engine, int /*local_index*/) {
+		auto count = (unsigned)engine.get_thread_count();
+		if (count == 1) {
+			return 0;
+		}
+		int a = (int)(next_rand() % count);
+		int b = (int)(next_rand() % (count - 1));
+		if (b >= a) {
+			b++;
+		}
+		return engine.get_loop_load(a) <= engine.get_loop_load(b) ? a : b;
+	}
+
+private:
+	static uint32_t next_rand() {
+		static thread_local uint32_t seed = (uint32_t)(uintptr_t)&seed | 1;
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		return seed;
+	}
+};
+
+#endif
@@ -1,10 +1,13 @@
 #include <unistd.h>
+#include <fcntl.h>
 #include <assert.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <arpa/inet.h>
 #include "epoll_channel.h"
 #include "epoll_executor.h"
+#include "epoll_balancer.h"
 
 int get_socket_error(int fd)
 {
@@ -21,18 +24,29 @@ EpollChannel::EpollChannel(shared_ptr<EpollEngine> engine, int fd, shared_ptr<vo
 	_engine = engine;
 
 	_is_released = false;
-
-	_w_buf = new Buffer(DEF_BUFFER_SIZE);
-	_r_buf = new Buffer(DEF_BUFFER_SIZE);
+	_is_edge = false;
+	_trigger_mode = EPOLL_TRIGGER_DEFAULT;
+	_loop_index = -1;
+	_gen = 0;
+	_uring_flags = 0;
+
+	_r_buf = NULL;
+	_r_hwm = 0;
+	_buf_bytes = 0;
 }
 
 EpollChannel::~EpollChannel()
 {
+	if (_buf_bytes > 0) {
+		auto engine = _engine.lock();
+		if (engine) {
+			engine->add_buffer_bytes(this, -(int64_t)_buf_bytes);
+		}
+	}
 	if (_fd != -1) {
 		close(_fd);	
 		_fd = -1;
 	}
-	delete _w_buf;
 	delete _r_buf;
 }
 
@@ -41,6 +55,37 @@ bool EpollChannel::set_events(int events)
 	return get_engine()->set(shared_from_this(), events);
 }
     
+EpollTimerId EpollChannel::run_after(uint64_t delay_ms, EpollTimerFunc func)
+{
+	auto engine = get_engine();
+	return engine->run_after(engine->get_loop_index(this), delay_ms, std::move(func));
+}
+
+EpollTimerId EpollChannel::run_every(uint64_t interval_ms, EpollTimerFunc func)
+{
+	auto engine = get_engine();
+	return engine->run_every(engine->get_loop_index(this), interval_ms, std::move(func));
+}
+
+bool EpollChannel::cancel_timer(EpollTimerId id)
+{
+	auto engine = get_engine();
+	return engine->cancel(engine->get_loop_index(this), id);
+}
+
+void EpollChannel::update_buffer_bytes()
+{
+	auto bytes = (_r_buf ? _r_buf->capacity() : 0) + _w_queue.bytes();
+	if (bytes == _buf_bytes) {
+		return ;
+	}
+	auto engine = _engine.lock();
+	if (engine) {
+		engine->add_buffer_bytes(this, (int64_t)bytes - (int64_t)_buf_bytes);
+	}
+	_buf_bytes = bytes;
+}
+
 shared_ptr<EpollEngine> EpollChannel::get_engine()
 {
 	auto e = _engine.lock();
@@ -54,45 +99,142 @@ EpollChannelConnect::EpollChannelConnect(shared_ptr<EpollEngine> engine, int fd,
 :EpollChannel(engine, fd, argv)
 {
 	_is_established = false;
+	_send_inflight = false;
+	_send_err = 0;
+	_recv_budget_bytes = RECV_BUDGET_BYTES;
+	_recv_budget_count = RECV_BUDGET_COUNT;
 }
 
 bool EpollChannelConnect::init()
 {
+	// 注册后loop线程可能立即回调，需先置为已建立
+	_is_established = true;
 	auto ret = set_events(EPOLL_RECV);
-	if (ret) {
-		_is_established = true;
+	if (!ret) {
+		_is_established = false;
 	}
 	return ret;
 }
 
 void EpollChannelConnect::on_send()
+{
+	{
+		lock_guard<mutex> lock(_mutex);
+		if (!is_ok() || _send_inflight) {
+			return ;
+		}
+		if (is_edge()) {
+			flush();
+		} else if (_w_queue.empty()) {
+			set_events(EPOLL_RECV);
+			return ;
+		} else {
+			auto ret = write_queue();
+			if (ret > 0) {
+				if (_w_queue.empty()) {
+				//	printf("[%d] %s|send is complete, fd:%d\n", gettid(), __FUNCTION__, get_fd());
+					set_events(EPOLL_RECV);
+				}
+			} else if (!(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+				on_send_fail(errno);
+			}
+		}
+		update_buffer_bytes();
+	}
+	report_send_fail();
+}
+
+ssize_t EpollChannelConnect::write_queue()
+{
+	struct iovec iov[SEND_IOV_MAX];
+	auto count = _w_queue.fill(iov, SEND_IOV_MAX);
+	auto ret = writev(_fd, iov, count);
+	if (ret > 0) {
+		_w_queue.consume(ret);
+	}
+	return ret;
+}
+
+void EpollChannelConnect::flush()
+{
+	while (!_w_queue.empty()) {
+		auto ret = write_queue();
+		if (ret > 0) {
+			continue ;
+		}
+		if (errno == EINTR) {
+			continue ;
+		}
+		if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			break ;
+		}
+		on_send_fail(errno);
+		break ;
+	}
+}
+
+int EpollChannelConnect::prepare_send(struct iovec* iov, int max)
 {
 	lock_guard<mutex> lock(_mutex);
-	if (!is_ok()) {
-		return ;
+	if (!is_ok() || _send_inflight) {
+		return 0;
 	}
-	if (!_w_buf->used_size()) {
-		set_events(EPOLL_RECV);
-		return ;
+	auto count = _w_queue.fill(iov, max);
+	if (count > 0) {
+		_w_queue.seal(count);
+		_send_inflight = true;
 	}
-	auto send_size = _w_buf->used_size();
-	auto ret = send(_fd, _w_buf->data(), send_size, 0);
-	if (ret > 0) {
-		if (ret == send_size) {
-		//	printf("[%d] %s|send is complete, fd:%d\n", gettid(), __FUNCTION__, get_fd());
-			set_events(EPOLL_RECV);
+	return count;
+}
+
+void EpollChannelConnect::on_send_complete(int res, bool valid)
+{
+	{
+		lock_guard<mutex> lock(_mutex);
+		_send_inflight = false;
+		_w_queue.seal(0);
+		if (res > 0) {
+			_w_queue.consume(res);
 		}
-		_w_buf->skip(ret);
-	} else if (!(errno == EAGAIN || errno == EWOULDBLOCK)) {
-		if (errno == EPIPE) {
-			printf("[%d] %s|channel.close, fd:%d\n", gettid(), __FUNCTION__, get_fd());
-			on_close();
-		} else {
-			auto err = get_socket_error(get_fd());
-			printf("[%d] %s|channel.error, fd:%d, err:%d\n", gettid(), __FUNCTION__, get_fd(), err);
-			on_error(errno);
+		if (valid && is_ok()) {
+			if (res < 0 && res != -EAGAIN && res != -EINTR && res != -ECANCELED) {
+				on_send_fail(-res);
+			} else if (_w_queue.empty()) {
+				set_events(EPOLL_RECV);
+			}
 		}
-		release();
+		update_buffer_bytes();
+	}
+	report_send_fail();
+}
+
+void EpollChannelConnect::on_send_fail(int err)
+{
+	if (err == EPIPE) {
+		printf("[%d] %s|channel.close, fd:%d\n", gettid(), __FUNCTION__, get_fd());
+	} else {
+		printf("[%d] %s|channel.error, fd:%d, err:%d\n", gettid(), __FUNCTION__, get_fd(), get_socket_error(get_fd()));
+	}
+	_send_err = err;
+	_w_queue.clear();
+	release();
+}
+
+void EpollChannelConnect::report_send_fail()
+{
+	if (!is_released()) {
+		return ;
+	}
+	int err;
+	{
+		lock_guard<mutex> lock(_mutex);
+		err = _send_err;
+		_send_err = 0;
+	}
+	if (err == EPIPE) {
+		on_close();
+	} else if (err != 0) {
+		on_error(err);
 	}
 }
 
@@ -105,23 +247,71 @@ void EpollChannelConnect::on_recv()
 		}
 	}
 
-	char buf[RECV_BUF_SIZE];
-	auto ret = recv(_fd, buf, sizeof(buf), 0);
-	if (ret > 0) {
-		on_recv(buf, ret);
-	} else {
-		if (ret == 0) {
-			printf("[%d] %s|channel.close, fd:%d\n", gettid(), __FUNCTION__, get_fd());
-			on_close();
-		} else {
-			auto err = get_socket_error(get_fd());
-			printf("[%d] %s|channel.error, fd:%d, err:%d\n", gettid(), __FUNCTION__, get_fd(), err);
-			on_error(err);
+	char extra[RECV_BUF_SIZE];
+	size_t total = 0;
+	int count = 0;
+	while (1) {
+		ssize_t ret;
+		size_t want;
+		{
+			// 直接读入_r_buf的可写空间，放不下的部分落到栈上再追加
+			lock_guard<mutex> lock(_mutex);
+			if (!_r_buf) {
+				_r_buf = new ChainBuffer;
+			}
+			_r_buf->reserve(RECV_RESERVE_SIZE);
+			struct iovec iov[2];
+			iov[0].iov_base = _r_buf->write_ptr();
+			iov[0].iov_len = _r_buf->writable_size();
+			iov[1].iov_base = extra;
+			iov[1].iov_len = sizeof(extra);
+			want = iov[0].iov_len + iov[1].iov_len;
+			ret = readv(_fd, iov, 2);
+			if (ret > 0) {
+				if ((size_t)ret <= iov[0].iov_len) {
+					_r_buf->commit(ret);
+				} else {
+					_r_buf->commit(iov[0].iov_len);
+					_r_buf->set(extra, ret - iov[0].iov_len);
+				}
+			}
 		}
-		release();
+		if (ret > 0) {
+			dispatch();
+			if (is_released()) {
+				return ;
+			}
+			// 边缘触发读到EAGAIN为止；水平触发读到内核缓冲区读空或用完预算
+			total += ret;
+			count++;
+			if (!is_edge() && ((size_t)ret < want || total >= _recv_budget_bytes || count >= _recv_budget_count)) {
+				return ;
+			}
+			continue ;
+		}
+		if (ret == -1 && errno == EINTR) {
+			continue ;
+		}
+		if (ret == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			return ;
+		}
+		on_recv_fail(ret == 0 ? 0 : get_socket_error(get_fd()));
+		return ;
 	}
 }
 
+void EpollChannelConnect::on_recv_fail(int err)
+{
+	if (err == 0) {
+		printf("[%d] %s|channel.close, fd:%d\n", gettid(), __FUNCTION__, get_fd());
+		on_close();
+	} else {
+		printf("[%d] %s|channel.error, fd:%d, err:%d\n", gettid(), __FUNCTION__, get_fd(), err);
+		on_error(err);
+	}
+	release();
+}
+
 void EpollChannelConnect::on_recv(const char* data, size_t size)
 {
 	{
@@ -129,21 +319,89 @@ void EpollChannelConnect::on_recv(const char* data, size_t size)
 		if (!is_ok()) {
 			return ;
 		}
+		if (!_r_buf) {
+			_r_buf = new ChainBuffer;
+		}
 		_r_buf->set(data, size);
 	}
+	dispatch();
+}
+
+void EpollChannelConnect::dispatch()
+{
+	int ret = 0;
+	bool legacy = false;
+	size_t peak = 0;
 	while (1) {
-		string buffer;
+		size_t header_size = 0;
+		const char* frame;
 		{
 			lock_guard<mutex> lock(_mutex);
-			auto ret = get_packet(_r_buf->data(), _r_buf->used_size(), buffer);
-			if (ret > 0) {
+			if (peak == 0) {
+				peak = _r_buf->used_size();
+			}
+			if (_r_buf->used_size() == 0) {
+				ret = 0;
+				shrink_recv(peak);
+				break ;
+			}
+			ret = parse(header_size, legacy);
+			// 帧跨越block时合并后重试，只拷贝未解析的数据
+			if (ret == 0 && _r_buf->front_size() < _r_buf->used_size()) {
+				_r_buf->pullup(_r_buf->used_size());
+				ret = parse(header_size, legacy);
+			}
+			if (legacy && ret > 0) {
 				_r_buf->skip(ret);
-			} else {
+			}
+			if (ret <= 0) {
+				shrink_recv(peak);
 				break ;
 			}
+			frame = _r_buf->data();
 		}
-		on_message(buffer);
+		if (legacy) {
+			on_message(_packet);
+		} else {
+			// _r_buf只由loop线程修改，回调期间frame保持有效，返回后才消费
+			on_message(string_view(frame, ret), header_size);
+			lock_guard<mutex> lock(_mutex);
+			_r_buf->skip(ret);
+		}
+		if (is_released()) {
+			return ;
+		}
+	}
+	// 原地分帧出错(如超过最大帧长)时数据流已无法继续解析，关闭连接
+	if (ret < 0 && !legacy) {
+		on_recv_fail(EPROTO);
+	}
+}
+
+void EpollChannelConnect::shrink_recv(size_t peak)
+{
+	// 高水位每次读空衰减一半，持续大流量的连接保留一个block供下次直接读入，
+	// 小包或空闲连接读空即归还；超大block在读空时已由skip释放
+	_r_hwm = _r_hwm / 2 > peak ? _r_hwm / 2 : peak;
+	if (_r_buf->used_size() == 0 && _r_hwm < RECV_SHRINK_SIZE) {
+		_r_buf->release();
 	}
+	update_buffer_bytes();
+}
+
+int EpollChannelConnect::parse(size_t& header_size, bool& legacy)
+{
+	auto ret = get_frame(_r_buf->data(), _r_buf->front_size(), header_size);
+	legacy = ret == FRAME_UNSUPPORTED;
+	if (legacy) {
+		// get_packet未完整时可能返回负数，无法区分是否跨block，直接合并全部未解析数据
+		if (_r_buf->front_size() < _r_buf->used_size()) {
+			_r_buf->pullup(_r_buf->used_size());
+		}
+		_packet.clear();
+		ret = get_packet(_r_buf->data(), _r_buf->front_size(), _packet);
+	}
+	return ret;
 }
 
 bool EpollChannelConnect::send_buffer(const string& data)
@@ -154,18 +412,113 @@ bool EpollChannelConnect::send_buffer(const string& data)
 			printf("%s|fd:%d, goto not ok\n", __FUNCTION__, get_fd());
 			return false;
 		}
+		if (data.length() == 0) {
+			return true;
+		}
+		auto old_bytes = _w_queue.bytes();
+		_w_queue.push(data.c_str(), data.length());
+		if (!commit_send(old_bytes)) {
+			return false;
+		}
 	}
-	if (data.length() > 0) {
-		{
-			auto old_size = _w_buf->size();
-			lock_guard<mutex> lock(_mutex);
-			_w_buf->set(data.c_str(), data.length());
-			if (!set_events(EPOLL_SEND | EPOLL_RECV)) {
-				_w_buf->truncate(old_size);
-				return false;
-			}
+	return check_send();
+}
+
+bool EpollChannelConnect::send_buffer(string&& data)
+{
+	{
+		lock_guard<mutex> lock(_mutex);
+		if (!is_ok()) {
+			printf("%s|fd:%d, goto not ok\n", __FUNCTION__, get_fd());
+			return false;
+		}
+		if (data.length() == 0) {
+			return true;
+		}
+		auto old_bytes = _w_queue.bytes();
+		// 小数据拷贝合并，避免每个slice单独一次writev分段
+		if (data.length() <= SEND_COALESCE_SIZE) {
+			_w_queue.push(data.c_str(), data.length());
+		} else {
+			_w_queue.push(std::move(data));
+		}
+		if (!commit_send(old_bytes)) {
+			return false;
 		}
 	}
+	return check_send();
+}
+
+bool EpollChannelConnect::send_buffer(shared_ptr<const string> data)
+{
+	{
+		lock_guard<mutex> lock(_mutex);
+		if (!is_ok()) {
+			printf("%s|fd:%d, goto not ok\n", __FUNCTION__, get_fd());
+			return false;
+		}
+		if (!data || data->length() == 0) {
+			return true;
+		}
+		auto old_bytes = _w_queue.bytes();
+		_w_queue.push(std::move(data));
+		if (!commit_send(old_bytes)) {
+			return false;
+		}
+	}
+	return check_send();
+}
+
+bool EpollChannelConnect::send_buffer(string&& header, shared_ptr<const string> body)
+{
+	{
+		lock_guard<mutex> lock(_mutex);
+		if (!is_ok()) {
+			printf("%s|fd:%d, goto not ok\n", __FUNCTION__, get_fd());
+			return false;
+		}
+		auto old_bytes = _w_queue.bytes();
+		if (header.length() <= SEND_COALESCE_SIZE) {
+			_w_queue.push(header.c_str(), header.length());
+		} else {
+			_w_queue.push(std::move(header));
+		}
+		_w_queue.push(std::move(body));
+		if (_w_queue.bytes() == old_bytes) {
+			return true;
+		}
+		if (!commit_send(old_bytes)) {
+			return false;
+		}
+	}
+	return check_send();
+}
+
+bool EpollChannelConnect::commit_send(size_t old_bytes)
+{
+	// 队列原本为空时socket通常可写，直接写出，只有剩余部分才注册EPOLLOUT；
+	// 队列非空说明已在等待可写事件，由on_send继续发送
+	if (old_bytes == 0 && !_send_inflight) {
+		flush();
+	}
+	// 边缘触发下EPOLLOUT已常驻注册，EAGAIN后由下一次可写边沿继续
+	bool flag = true;
+	if (!_w_queue.empty() && !is_released() && !is_edge() && !set_events(EPOLL_SEND | EPOLL_RECV)) {
+		_w_queue.truncate(old_bytes);
+		flag = false;
+	}
+	update_buffer_bytes();
+	return flag;
+}
+
+bool EpollChannelConnect::check_send()
+{
+	// 非loop线程写出错时loop可能不会再收到事件，这里直接摘除
+	if (is_released()) {
+		report_send_fail();
+		get_engine()->del(shared_from_this());
+		return false;
+	}
 	return true;
 }
 
@@ -262,9 +615,188 @@ EpollChannelServer::EpollChannelServer(
 	_host = host;
 	_port = port;
 	_backlog = backlog;
+
+	// 用户自定义的on_accept未必accept到EAGAIN，监听socket默认水平触发
+	_trigger_mode = EPOLL_TRIGGER_LEVEL;
+
+	_reuseport = false;
+	_cpu_steering = false;
+	_spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
+EpollChannelServer::~EpollChannelServer()
+{
+	auto engine = _engine.lock();
+	for (auto& item : _listeners) {
+		item->release();
+		if (engine) {
+			engine->del(item);
+		}
+	}
+	auto spare = _spare_fd.exchange(-1);
+	if (spare != -1) {
+		close(spare);
+	}
 }
 
 bool EpollChannelServer::init()
+{
+	// reuseport下内核已按loop分流，默认不再转移到其他loop
+	if (!_balancer) {
+		if (_reuseport) {
+			_balancer = make_shared<EpollBalancerLocal>();
+		} else {
+			_balancer = make_shared<EpollBalancerRoundRobin>();
+		}
+	}
+
+	if (_reuseport) {
+		return init_reuseport();
+	}
+
+	auto fd = create_listener();
+	if (fd == -1) {
+		return false;
+	}
+	set_fd(fd);
+	if (!set_events(EPOLL_RECV)) {
+		printf("%s|events_set fail, fd:%d, flag:EPOLL_RECV\n", __PRETTY_FUNCTION__, fd);
+		return false;
+	}
+	return true;
+}
+
+bool EpollChannelServer::init_reuseport()
+{
+	// 子类的on_accept()只知道get_fd()，无法accept其他loop上的监听socket，
+	// 这些socket水平触发下会一直可读空转，因此reuseport模式必须使用内置acceptor
+	if (!_factory) {
+		printf("%s|reuseport requires a connect factory\n", __PRETTY_FUNCTION__);
+		return false;
+	}
+
+	auto engine = get_engine();
+	auto count = engine->get_thread_count();
+
+	// 自身作为loop[0]的监听socket
+	auto fd = create_listener();
+	if (fd == -1) {
+		return false;
+	}
+	set_fd(fd);
+	set_loop_index(0);
+
+	if (_cpu_steering && NetUtils::set_reuseport_cpu_steering(fd, count) == -1) {
+		printf(
+			"%s|set_reuseport_cpu_steering fail, fd:%d, error:%s\n", 
+			__PRETTY_FUNCTION__, 
+			fd, 
+			strerror(errno)
+		);
+	}
+
+	bool flag = true;
+	auto server = static_pointer_cast<EpollChannelServer>(shared_from_this());
+	for (int i = 1; i < count; i++) {
+		auto listen_fd = create_listener();
+		if (listen_fd == -1) {
+			flag = false;
+			break ;
+		}
+		auto listener = make_shared<EpollChannelListener>(engine, listen_fd, server);
+		listener->set_loop_index(i);
+		if (!engine->set(listener, EPOLL_RECV)) {
+			printf("%s|events_set fail, fd:%d, flag:EPOLL_RECV\n", __PRETTY_FUNCTION__, listen_fd);
+			flag = false;
+			break ;
+		}
+		_listeners.push_back(listener);
+	}
+
+	if (flag && !set_events(EPOLL_RECV)) {
+		printf("%s|events_set fail, fd:%d, flag:EPOLL_RECV\n", __PRETTY_FUNCTION__, fd);
+		flag = false;
+	}
+
+	if (!flag) {
+		for (auto& item : _listeners) {
+			item->release();
+			engine->del(item);
+		}
+		_listeners.clear();
+	}
+	return flag;
+}
+
+void EpollChannelServer::on_accept(int listen_fd)
+{
+	if (!_factory) {
+		on_accept();
+		return ;
+	}
+	auto index = get_engine()->get_current_loop();
+	accept_batch(listen_fd, index >= 0 ? index : 0);
+}
+
+void EpollChannelServer::accept_batch(int listen_fd, int local_index)
+{
+	while (1) {
+		auto fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd == -1) {
+			if (errno == EINTR || errno == ECONNABORTED || errno == EPROTO) {
+				continue ;
+			}
+			// fd耗尽时连接留在监听队列，水平触发下会持续可读空转，拒绝掉这些连接
+			if ((errno == EMFILE || errno == ENFILE) && drop_one(listen_fd)) {
+				continue ;
+			}
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				printf(
+					"[%d] %s|accept4 fail, listen_fd:%d, error:%s\n", 
+					gettid(), 
+					__FUNCTION__, 
+					listen_fd, 
+					strerror(errno)
+				);
+			}
+			break ;
+		}
+		accept_fd(fd, local_index);
+	}
+}
+
+bool EpollChannelServer::drop_one(int listen_fd)
+{
+	auto spare = _spare_fd.exchange(-1);
+	if (spare == -1) {
+		return false;
+	}
+	close(spare);
+	auto fd = accept(listen_fd, NULL, NULL);
+	if (fd != -1) {
+		close(fd);
+		printf("[%d] %s|fd exhausted, connection dropped, listen_fd:%d\n", gettid(), __FUNCTION__, listen_fd);
+	}
+	_spare_fd.store(open("/dev/null", O_RDONLY | O_CLOEXEC));
+	return fd != -1;
+}
+
+void EpollChannelServer::accept_fd(int fd, int local_index)
+{
+	auto engine = get_engine();
+	auto conn = _factory(engine, fd);
+	if (!conn) {
+		close(fd);
+		return ;
+	}
+	conn->set_loop_index(_balancer->select(*engine, local_index));
+	if (!conn->init()) {
+		printf("[%d] %s|conn init fail, fd:%d\n", gettid(), __FUNCTION__, fd);
+		conn->release();
+	}
+}
+
+int EpollChannelServer::create_listener()
 {
     struct sockaddr_in addr;
     memset(&addr, 0, sizeof(addr));
@@ -281,7 +813,7 @@ bool EpollChannelServer::init()
 	auto fd = socket(AF_INET, SOCK_STREAM, 0);
 	if (fd == -1) {
 		printf("%s|socket fail, error:%s\n", __FUNCTION__, strerror(errno));
-		return false;
+		return -1;
 	}
 
 	int ret = -1;
@@ -291,7 +823,32 @@ bool EpollChannelServer::init()
 			printf(
 				"%s|set_socket_reuseaddr fail, fd:%d, error:%s\n", 
 				__PRETTY_FUNCTION__, 
-				get_fd(), 
+				fd, 
+				strerror(errno)
+			);
+			break ;
+		}
+
+		if (_reuseport) {
+			ret = NetUtils::set_socket_reuseport(fd);
+			if (ret == -1) {
+				printf(
+					"%s|set_socket_reuseport fail, fd:%d, error:%s\n", 
+					__PRETTY_FUNCTION__, 
+					fd, 
+					strerror(errno)
+				);
+				break ;
+			}
+		}
+
+		// 监听socket可能被多次唤醒或与其他进程竞争，accept不能阻塞loop线程
+		ret = NetUtils::set_socket_unblock(fd);
+		if (ret == -1) {
+			printf(
+				"%s|set_socket_unblock fail, fd:%d, error:%s\n", 
+				__PRETTY_FUNCTION__, 
+				fd, 
 				strerror(errno)
 			);
 			break ;
@@ -302,7 +859,7 @@ bool EpollChannelServer::init()
 			printf(
 				"%s|bind fail, fd:%d, error:%s\n", 
 				__PRETTY_FUNCTION__, 
-				get_fd(), 
+				fd, 
 				strerror(errno)
 			);
 			break ;
@@ -313,7 +870,7 @@ bool EpollChannelServer::init()
 			printf(
 				"%s|listen fail, fd:%d, error:%s\n", 
 				__PRETTY_FUNCTION__, 
-				get_fd(), 
+				fd, 
 				strerror(errno)
 			);
 			break ;
@@ -323,13 +880,27 @@ bool EpollChannelServer::init()
 
 	if (ret != 0) {
 		close(fd);
-	} else {
-		set_fd(fd);
-		if (!set_events(EPOLL_RECV)) {
-			printf("%s|events_set fail, fd:%d, flag:EPOLL_RECV\n", __PRETTY_FUNCTION__, fd);
-			ret = -1;
-		}
+		return -1;
 	}
-	return !ret ? true : false;
+	return fd;
 }
 
+EpollChannelListener::EpollChannelListener(
+	shared_ptr<EpollEngine> engine, 
+	int fd, 
+	shared_ptr<EpollChannelServer> server
+) : EpollChannel(engine, fd)
+{
+	_server = server;
+	_trigger_mode = EPOLL_TRIGGER_LEVEL;
+}
+
+void EpollChannelListener::on_recv()
+{
+	auto server = _server.lock();
+	if (!server || server->is_released()) {
+		release();
+		return ;
+	}
+	server->on_accept(get_fd());
+}
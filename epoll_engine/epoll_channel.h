@@ -3,23 +3,53 @@
 
 #include <memory>
 #include <mutex>
+#include <functional>
+#include <atomic>
+#include <vector>
+#include <string_view>
+#include <climits>
 #include <sys/syscall.h>
 
 #include "../buffer.h"
+#include "../chain_buffer.h"
 #include "../net_utils.h"
+#include "epoll_timer_wheel.h"
+#include "epoll_send_queue.h"
 
 using namespace std;
 
+// readv的栈上溢出区，_r_buf剩余空间不足时接住多出的数据
 const int RECV_BUF_SIZE = (1024 * 32);
 
+// 每次readv前_r_buf至少保留的可写空间
+const int RECV_RESERVE_SIZE = (1024 * 4);
+
+// 接收缓冲区读空时，高水位低于该值即归还全部block
+const size_t RECV_SHRINK_SIZE = (1024 * 8);
+
+// 水平触发下每次唤醒的读取上限，边缘触发始终读到EAGAIN
+const size_t RECV_BUDGET_BYTES = (1024 * 256);
+
+const int RECV_BUDGET_COUNT = 8;
+
 const int DEF_BUFFER_SIZE = 1024;
 
+// get_frame的默认返回值，表示子类未实现原地分帧，改走get_packet/on_message(const string&)
+const int FRAME_UNSUPPORTED = INT_MIN;
+
 enum EpollEvent
 {
 	EPOLL_RECV = 0x1,
 	EPOLL_SEND = 0x2,
 };
 
+enum EpollTriggerMode
+{
+	EPOLL_TRIGGER_DEFAULT = 0,	// 跟随EpollEngine设置
+	EPOLL_TRIGGER_LEVEL,
+	EPOLL_TRIGGER_EDGE,
+};
+
 inline int gettid()
 {
 	return syscall(SYS_gettid);
@@ -51,6 +81,26 @@ public:
 
 	bool is_released() {return _is_released;}
 
+	// 在所属loop上设置定时器，只能在该loop线程(即channel回调中)调用
+	EpollTimerId run_after(uint64_t delay_ms, EpollTimerFunc func);
+
+	EpollTimerId run_every(uint64_t interval_ms, EpollTimerFunc func);
+
+	bool cancel_timer(EpollTimerId id);
+
+	// 注册前设置，覆盖EpollEngine的触发模式
+	void set_trigger_mode(EpollTriggerMode mode) {_trigger_mode = mode;}
+
+	EpollTriggerMode get_trigger_mode() {return _trigger_mode;}
+
+	// 是否以EPOLLET注册，由EpollEngine在注册时确定
+	bool is_edge() {return _is_edge;}
+
+	// 注册前指定所属loop，-1表示按fd取模
+	void set_loop_index(int index) {_loop_index = index;}
+
+	int get_loop_index() {return _loop_index;}
+
 protected:
 	void set_fd(int fd) {_fd = fd;}
 
@@ -58,13 +108,32 @@ protected:
 
 	shared_ptr<EpollEngine> get_engine();
 
+	// 缓冲区占用变化后同步到引擎的统计，调用方需持有_mutex
+	void update_buffer_bytes();
+
 protected:
     int  _fd;
 	int  _events;
 	bool _is_released;
+	bool _is_edge;
+	int  _loop_index;
+
+	EpollTriggerMode	_trigger_mode;
+
+	// 当前epoll注册代数，0表示未注册，由EpollEngine维护
+	atomic<uint16_t>	_gen;
+
+	// io_uring后端下的请求状态，仅由所属loop线程访问
+	int		_uring_flags;
 
-    Buffer *_w_buf;
-    Buffer *_r_buf;
+    EpollSendQueue	_w_queue;
+
+	// 首次收到数据时分配，读空后按高水位策略归还block
+    ChainBuffer *_r_buf;
+	size_t	_r_hwm;
+
+	// 已计入引擎统计的缓冲区字节数
+	size_t	_buf_bytes;
 
     mutex  _mutex;
 
@@ -88,16 +157,89 @@ public:
 	virtual void on_close() {;}
 	virtual void on_error(int error) {;}
 
-	virtual bool on_message(const string& buffer) = 0;
+	// 拷贝分帧接口，子类实现此组或下面的原地分帧接口之一
+	virtual bool on_message(const string& /*buffer*/) {return true;}
+
+	virtual int get_packet(const char* /*data*/, size_t /*size*/, string& /*buffer*/) {return -1;}
 
-	virtual int get_packet(const char* data, size_t size, string& buffer) = 0;
+	// 原地分帧：返回完整帧长度，0表示数据不足，小于0表示出错(以EPROTO关闭连接)；
+	// header_size可选填写帧头长度，随帧一起传给on_message
+	virtual int get_frame(const char* /*data*/, size_t /*size*/, size_t& /*header_size*/) {return FRAME_UNSUPPORTED;}
 
+	// frame直接指向接收缓冲区，只在回调期间有效，需要保留时自行拷贝
+	virtual bool on_message(string_view /*frame*/, size_t /*header_size*/) {return true;}
+
+	// 以下发送接口可在任意线程调用，按调用顺序写出
 	bool send_buffer(const string& data);
 
+	// 接管data，发送过程中不再拷贝
+	bool send_buffer(string&& data);
+
+	// 共享数据，可同时发给多个连接
+	bool send_buffer(shared_ptr<const string> data);
+
+	// 头部与共享数据体一起入队，中间不会插入其他发送
+	bool send_buffer(string&& header, shared_ptr<const string> body);
+
+	// 对端关闭(err为0)或读出错时的统一处理，io_uring后端收到recv完成事件时也调用
+	void on_recv_fail(int err);
+
+	// io_uring后端：以待发送数据填充iov并标记发送在途，在途期间不再直接写出，
+	// 已填充的slice保持不变；未建立连接、已有在途发送或无数据时返回0，由调用方改用POLLOUT
+	int prepare_send(struct iovec* iov, int max);
+
+	// io_uring后端的sendmsg完成，res为发送字节数或-errno；valid为false时只确认已发送的数据
+	void on_send_complete(int res, bool valid);
+
+	// 水平触发下每次可读事件最多读取的字节数与次数，避免单个连接占满loop
+	void set_recv_budget(size_t bytes, int count) {
+		_recv_budget_bytes = bytes;
+		_recv_budget_count = count;
+	}
+
 protected:
 	bool is_ok() {return !is_released() && _is_established;}
 
+	// 发送到_w_queue为空或EAGAIN，调用方需持有_mutex
+	void flush();
+
+	// 对_w_queue执行一次writev，返回值同writev
+	ssize_t write_queue();
+
+	// 数据入队后的发送：队列原本为空时直接写，写不完再注册写事件，调用方需持有_mutex
+	bool commit_send(size_t old_bytes);
+
+	// 发送路径出错后的收尾，不能持有_mutex
+	bool check_send();
+
+	// 记录发送错误并释放连接，调用方需持有_mutex；回调由report_send_fail在解锁后执行
+	void on_send_fail(int err);
+
+	// 取出记录的发送错误并回调on_close/on_error，不能持有_mutex，回调中可再调用send_buffer
+	void report_send_fail();
+
+	// 从_r_buf中切出完整包并逐个回调on_message，优先原地分帧，只在loop线程调用
+	void dispatch();
+
+	// 对_r_buf首个block调用get_frame，未实现时合并全部数据再调用get_packet，调用方需持有_mutex
+	int parse(size_t& header_size, bool& legacy);
+
+	// 分帧后收缩接收缓冲区，peak为本次读入后的数据量，调用方需持有_mutex
+	void shrink_recv(size_t peak);
+
 	bool _is_established;
+
+	// io_uring后端有sendmsg在途，由_mutex保护
+	bool _send_inflight;
+
+	// 待回调的发送错误，0为无，由_mutex保护
+	int		_send_err;
+
+	size_t	_recv_budget_bytes;
+	int		_recv_budget_count;
+
+	// 复用的包缓冲，避免每个包重新分配
+	string	_packet;
 };
 
 class EpollChannelClient : public EpollChannelConnect
@@ -120,10 +262,6 @@ public:
 	virtual void on_close() {;}
 	virtual void on_error(int error) {;}
 
-	virtual bool on_message(const string& buffer) = 0;
-
-	virtual int get_packet(const char* data, size_t size, string& buffer) = 0;
-
 	string get_host() {return _host;}
 
 	int get_port() {return _port;}
@@ -135,8 +273,16 @@ private:
 	bool	_first_send_event;
 };
 
+class EpollBalancer;
+
+class EpollChannelListener;
+
+typedef function<shared_ptr<EpollChannelConnect>(shared_ptr<EpollEngine> engine, int fd)> EpollConnectFactory;
+
 class EpollChannelServer : public EpollChannel
 {
+friend class EpollEngine;
+friend class EpollChannelListener;
 public:
 	EpollChannelServer(
 		shared_ptr<EpollEngine> engine, 
@@ -146,25 +292,93 @@ public:
 		shared_ptr<void> argv = nullptr
 	);
 
-	virtual ~EpollChannelServer() {;}
+	virtual ~EpollChannelServer();
 
 	bool init();
 
 	void on_recv() {
-		on_accept();
+		on_accept(get_fd());
+	}
+
+	// init前调用，每个loop各创建一个SO_REUSEPORT监听socket，由内核在它们之间分发新连接；
+	// cpu_steering按收包cpu选择监听socket，loop线程绑核时可使连接处理与软中断同核。
+	// 须同时设置connect factory，否则init失败
+	void set_reuseport(bool on, bool cpu_steering = false) {
+		_reuseport = on;
+		_cpu_steering = cpu_steering;
 	}
 
+	// 设置后启用内置acceptor：每次唤醒accept直到EAGAIN，由factory构造连接，
+	// 并按balancer选择连接所属loop，未设置时默认轮询，reuseport模式下默认留在accept所在loop
+	void set_connect_factory(const EpollConnectFactory& factory) {_factory = factory;}
+
+	void set_balancer(shared_ptr<EpollBalancer> balancer) {_balancer = balancer;}
+
 	string get_host() {return _host;}
 	int    get_port() {return _port;}
 	int    get_backlog() {return _backlog;}
 
+	bool   is_reuseport() {return _reuseport;}
+
+	bool   has_factory() {return (bool)_factory;}
+
 protected:	
+	// listen_fd为可读的监听socket，reuseport模式下每个loop各一个，否则即get_fd()
+	virtual void on_accept(int listen_fd);
+
+	// 未设置factory时由子类自行accept，须accept到EAGAIN，否则水平触发下会持续可读；
+	// 设置factory后不会被调用，实现为空即可
 	virtual void on_accept() = 0;
 
+private:
+	int create_listener();
+
+	// accept直到EAGAIN
+	void accept_batch(int listen_fd, int local_index);
+
+	// fd耗尽时释放预留fd接下一个连接并关闭，使监听socket不再可读，成功返回true
+	bool drop_one(int listen_fd);
+
+	// 为已accept的fd构造连接并分配loop，io_uring后端的多路accept也经此处理
+	void accept_fd(int fd, int local_index);
+
+	bool init_reuseport();
+
 private:
 	string	_host;
 	int		_port;
 	int		_backlog;
+
+	bool	_reuseport;
+	bool	_cpu_steering;
+
+	// EMFILE/ENFILE时用于接下并拒绝连接的预留fd，多个loop争用时以exchange独占
+	atomic<int>	_spare_fd;
+
+	EpollConnectFactory			_factory;
+	shared_ptr<EpollBalancer>	_balancer;
+
+	vector<shared_ptr<EpollChannelListener>>	_listeners;
+};
+
+// reuseport模式下loop[1..n-1]上的监听socket，可读时转交给所属EpollChannelServer
+class EpollChannelListener : public EpollChannel
+{
+public:
+	EpollChannelListener(
+		shared_ptr<EpollEngine> engine, 
+		int fd, 
+		shared_ptr<EpollChannelServer> server
+	);
+
+	virtual ~EpollChannelListener() {;}
+
+	void on_recv();
+
+	shared_ptr<EpollChannelServer> get_server() {return _server.lock();}
+
+private:
+	weak_ptr<EpollChannelServer>	_server;
 };
 
 #endif
@@ -0,0 +1,259 @@
+#ifndef __EPOLL_CODEC_H__
+#define __EPOLL_CODEC_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define EPOLL_CODEC_X86 1
+#endif
+
+#include "epoll_channel.h"
+
+using namespace std;
+
+// 单帧默认上限，超出按协议错误关闭连接
+const size_t CODEC_DEF_MAX_FRAME = (1024 * 1024 * 16);
+
+// decode返回值：大于0为完整帧长度
+enum EpollCodecResult
+{
+	CODEC_AGAIN = 0,		// 数据不足
+	CODEC_ERROR = -1,		// 超过max_frame或格式错误
+};
+
+// 在[begin, end)中查找c，未找到返回end；x86上按cpu能力选择AVX2或SSE2
+#ifdef EPOLL_CODEC_X86
+__attribute__((target("avx2")))
+inline const char* codec_find_byte_avx2(const char* begin, const char* end, char c)
+{
+	auto needle = _mm256_set1_epi8(c);
+	while (end - begin >= 32) {
+		auto chunk = _mm256_loadu_si256((const __m256i*)begin);
+		auto mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle));
+		if (mask) {
+			return begin + __builtin_ctz(mask);
+		}
+		begin += 32;
+	}
+	auto p = (const char*)memchr(begin, c, end - begin);
+	return p ? p : end;
+}
+
+__attribute__((target("sse2")))
+inline const char* codec_find_byte_sse2(const char* begin, const char* end, char c)
+{
+	auto needle = _mm_set1_epi8(c);
+	while (end - begin >= 16) {
+		auto chunk = _mm_loadu_si128((const __m128i*)begin);
+		auto mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+		if (mask) {
+			return begin + __builtin_ctz(mask);
+		}
+		begin += 16;
+	}
+	auto p = (const char*)memchr(begin, c, end - begin);
+	return p ? p : end;
+}
+#endif
+
+inline const char* codec_find_byte(const char* begin, const char* end, char c)
+{
+#ifdef EPOLL_CODEC_X86
+	static const bool has_avx2 = __builtin_cpu_supports("avx2");
+	return has_avx2 ? codec_find_byte_avx2(begin, end, c) : codec_find_byte_sse2(begin, end, c);
+#else
+	auto p = (const char*)memchr(begin, c, end - begin);
+	return p ? p : end;
+#endif
+}
+
+// 固定长度帧头，帧头中LEN_OFFSET处LEN_BYTES字节为整数长度字段；
+// 长度字段默认只计帧体，include_header为true时计整帧
+template <size_t HEADER_SIZE, size_t LEN_OFFSET, int LEN_BYTES, bool BIG = true>
+class EpollFixedHeaderCodec
+{
+	static_assert(LEN_BYTES >= 1 && LEN_BYTES <= 8, "LEN_BYTES must be 1..8");
+	static_assert(LEN_OFFSET + LEN_BYTES <= HEADER_SIZE, "length field out of header");
+
+public:
+	EpollFixedHeaderCodec(size_t max_frame = CODEC_DEF_MAX_FRAME, bool include_header = false) {
+		_max_frame = max_frame;
+		_include_header = include_header;
+	}
+
+	void set_max_frame(size_t max_frame) {_max_frame = max_frame;}
+
+	void set_include_header(bool on) {_include_header = on;}
+
+	// 帧头只需解析一次，已判定的帧长在数据到齐前保留
+	int decode(const char* data, size_t size, size_t& header_size) {
+		if (_frame_size == 0) {
+			if (size < HEADER_SIZE) {
+				return CODEC_AGAIN;
+			}
+			uint64_t len = 0;
+			auto p = (const unsigned char*)data + LEN_OFFSET;
+			for (int i = 0; i < LEN_BYTES; i++) {
+				if (BIG) {
+					len = (len << 8) | p[i];
+				} else {
+					len |= (uint64_t)p[i] << (8 * i);
+				}
+			}
+			if (!_include_header) {
+				len += HEADER_SIZE;
+			}
+			if (len < HEADER_SIZE || len > _max_frame || len > INT_MAX) {
+				return CODEC_ERROR;
+			}
+			_frame_size = (size_t)len;
+		}
+		if (size < _frame_size) {
+			return CODEC_AGAIN;
+		}
+		header_size = HEADER_SIZE;
+		auto ret = (int)_frame_size;
+		_frame_size = 0;
+		return ret;
+	}
+
+private:
+	size_t	_max_frame;
+	bool	_include_header;
+	size_t	_frame_size = 0;
+};
+
+// N字节长度前缀
+template <int N, bool BIG = true>
+using EpollLengthCodec = EpollFixedHeaderCodec<N, 0, N, BIG>;
+
+// varint(LEB128)长度前缀，长度只计帧体
+class EpollVarintCodec
+{
+public:
+	EpollVarintCodec(size_t max_frame = CODEC_DEF_MAX_FRAME) {
+		_max_frame = max_frame;
+	}
+
+	void set_max_frame(size_t max_frame) {_max_frame = max_frame;}
+
+	int decode(const char* data, size_t size, size_t& header_size) {
+		if (_frame_size == 0) {
+			uint64_t len = 0;
+			size_t i = 0;
+			for (; i < size && i < VARINT_MAX_BYTES; i++) {
+				auto b = (unsigned char)data[i];
+				len |= (uint64_t)(b & 0x7f) << (7 * i);
+				if (!(b & 0x80)) {
+					break ;
+				}
+			}
+			if (i == VARINT_MAX_BYTES) {
+				return CODEC_ERROR;
+			}
+			if (i == size) {
+				return CODEC_AGAIN;
+			}
+			_header_size = i + 1;
+			if (len > _max_frame || len + _header_size > INT_MAX) {
+				return CODEC_ERROR;
+			}
+			_frame_size = _header_size + (size_t)len;
+		}
+		if (size < _frame_size) {
+			return CODEC_AGAIN;
+		}
+		header_size = _header_size;
+		auto ret = (int)_frame_size;
+		_frame_size = 0;
+		return ret;
+	}
+
+private:
+	enum {
+		VARINT_MAX_BYTES = 5,		// 长度不超过32位
+	};
+
+	size_t	_max_frame;
+	size_t	_frame_size = 0;
+	size_t	_header_size = 0;
+};
+
+// 分隔符分帧(如"\n"、"\r\n")，帧包含分隔符；
+// 记录已扫描位置，大帧分多次到达时不重复扫描
+class EpollDelimiterCodec
+{
+public:
+	EpollDelimiterCodec(const string& delimiter = "\n", size_t max_frame = CODEC_DEF_MAX_FRAME) {
+		_delimiter = delimiter.empty() ? "\n" : delimiter;
+		_max_frame = max_frame;
+	}
+
+	void set_max_frame(size_t max_frame) {_max_frame = max_frame;}
+
+	void set_delimiter(const string& delimiter) {
+		_delimiter = delimiter.empty() ? "\n" : delimiter;
+		_scanned = 0;
+	}
+
+	int decode(const char* data, size_t size, size_t& header_size) {
+		auto end = data + size;
+		auto dlen = _delimiter.size();
+		auto pos = data + (_scanned < size ? _scanned : size);
+		while (1) {
+			auto p = codec_find_byte(pos, end, _delimiter[0]);
+			if (p == end || (size_t)(end - p) < dlen) {
+				// 分隔符可能跨越本次数据末尾，从其首字节处继续
+				_scanned = p - data;
+				break ;
+			}
+			if (dlen == 1 || memcmp(p + 1, _delimiter.data() + 1, dlen - 1) == 0) {
+				auto frame = (size_t)(p - data) + dlen;
+				if (frame > _max_frame || frame > INT_MAX) {
+					return CODEC_ERROR;
+				}
+				header_size = 0;
+				_scanned = 0;
+				return (int)frame;
+			}
+			pos = p + 1;
+		}
+		if (_scanned >= _max_frame) {
+			return CODEC_ERROR;
+		}
+		return CODEC_AGAIN;
+	}
+
+private:
+	string	_delimiter;
+	size_t	_max_frame;
+	size_t	_scanned = 0;
+};
+
+// 将codec接入channel的原地分帧接口，子类只需实现on_message(string_view, size_t)；
+// Base可为EpollChannelConnect或EpollChannelClient
+template <class Codec, class Base = EpollChannelConnect>
+class EpollCodecChannel : public Base
+{
+public:
+	using Base::Base;
+
+	Codec& get_codec() {return _codec;}
+
+	int get_frame(const char* data, size_t size, size_t& header_size) {
+		auto ret = _codec.decode(data, size, header_size);
+		if (ret < 0) {
+			printf("[%d] %s|decode fail, fd:%d, size:%zu\n", gettid(), __FUNCTION__, this->get_fd(), size);
+		}
+		return ret;
+	}
+
+private:
+	Codec	_codec;
+};
+
+#endif
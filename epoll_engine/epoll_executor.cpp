@@ -1,16 +1,84 @@
 #include <unistd.h>
 #include <assert.h>
 #include <signal.h>
+#include <sys/resource.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #include "epoll_executor.h"
 
-EpollEngine::EpollEngine(int thread_count, int max_conn_count)
+thread_local EpollEngine* EpollEngine::t_engine = NULL;
+
+thread_local int EpollEngine::t_loop_index = -1;
+
+EpollFdTable::EpollFdTable(int max_fd)
+{
+	_max_fd = max_fd;
+	_chunk_count = (max_fd + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	_chunks = new atomic<EpollFdInfo*>[_chunk_count];
+	for (int i = 0; i < _chunk_count; i++) {
+		_chunks[i].store(NULL, memory_order_relaxed);
+	}
+}
+
+EpollFdTable::~EpollFdTable()
+{
+	for (int i = 0; i < _chunk_count; i++) {
+		delete [] _chunks[i].load(memory_order_relaxed);
+	}
+	delete [] _chunks;
+}
+
+EpollFdInfo* EpollFdTable::get_or_create(int fd)
+{
+	if (fd < 0 || fd >= _max_fd) {
+		return NULL;
+	}
+	auto& slot = _chunks[fd >> CHUNK_BITS];
+	auto chunk = slot.load(memory_order_acquire);
+	if (!chunk) {
+		// 同一chunk的fd可能分属不同loop，用cas安装
+		auto new_chunk = new EpollFdInfo[CHUNK_SIZE];
+		for (int i = 0; i < CHUNK_SIZE; i++) {
+			new_chunk[i].chan.store(NULL, memory_order_relaxed);
+			new_chunk[i].events = 0;
+			new_chunk[i].gen = 0;
+		}
+		if (slot.compare_exchange_strong(chunk, new_chunk, memory_order_acq_rel)) {
+			chunk = new_chunk;
+		} else {
+			delete [] new_chunk;
+		}
+	}
+	return &chunk[fd & (CHUNK_SIZE - 1)];
+}
+
+EpollEngine::EpollEngine(int thread_count, int max_conn_count, EpollBackend backend)
 {
 	signal(SIGPIPE, SIG_IGN);
+	_terminate = false;
+	_posting = 0;
+	_stop = false;
+	_edge_triggered = false;
+	_backend = backend;
     _max_count = max_conn_count;
 	_thread_count = thread_count;
+	_fd_count = 0;
+
+	struct rlimit rl;
+	int max_fd = EPOLL_DEF_MAX_FD;
+	if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+		max_fd = (rl.rlim_cur == RLIM_INFINITY || rl.rlim_cur > (rlim_t)EPOLL_MAX_FD) 
+			? EPOLL_MAX_FD : (int)rl.rlim_cur;
+	}
+	_fd_table = new EpollFdTable(max_fd);
+
     if (!create_epoll_infos()) {
+		delete _fd_table;
         throw runtime_error("EpollEngine.create_epoll_infos fail");
     }
+	if (_backend == EPOLL_BACKEND_URING && !create_urings()) {
+		_backend = EPOLL_BACKEND_EPOLL;
+	}
     for (int i = 0; i < _thread_count; i++) {
         _threads.emplace_back(thread([this, i] {
             run(i);
@@ -22,69 +90,302 @@ EpollEngine::EpollEngine(int thread_count, int max_conn_count)
 EpollEngine::~EpollEngine()
 {
     terminate();
+	delete _fd_table;
 }
 
 bool EpollEngine::set(shared_ptr<EpollChannel> chan, int events)
 {
-	lock_guard<mutex> lock(_mutex);
-
 	auto fd = chan->get_fd();
-	auto epoll_id = _epoll_infos[fd % _threads.size()].epoll_id;
+	auto fd_info = _fd_table->get_or_create(fd);
+	if (!fd_info) {
+		printf("[%d] %s|fd:%d out of range, max_fd:%d\n", gettid(), __FUNCTION__, fd, _fd_table->max_fd());
+		return false;
+	}
 
-	struct epoll_event ev;
-    memset(&ev, 0, sizeof(ev));
-	ev.data.fd = fd;
-	if (events & EPOLL_RECV) {
-		ev.events |= EPOLLIN;	
+	auto index = get_loop_index(chan.get());
+	auto& info = *_epoll_infos[index];
+	auto epoll_id = info.epoll_id;
+	bool uring = _backend == EPOLL_BACKEND_URING;
+	{
+		lock_guard<mutex> lock(info.lock);
+
+		auto cur = fd_info->chan.load(memory_order_relaxed);
+		if (cur && cur != chan.get()) {
+			printf("[%d] %s|fd:%d already bound to another channel\n", gettid(), __FUNCTION__, fd);
+			return false;
+		}
+
+		auto mode = cur ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+		if (mode == EPOLL_CTL_MOD && (fd_info->events == events || chan->_is_edge)) {
+			return true;
+		}
+
+		// io_uring后端按完成事件驱动，不区分触发模式
+		bool edge = !uring && (chan->_trigger_mode == EPOLL_TRIGGER_EDGE 
+			|| (chan->_trigger_mode == EPOLL_TRIGGER_DEFAULT && _edge_triggered));
+		if (mode == EPOLL_CTL_ADD && _fd_count.fetch_add(1) >= _max_count) {
+			_fd_count--;
+			printf("[%d] %s|cur_count:%d >= _max_count:%d\n", gettid(), __FUNCTION__, _fd_count.load(), _max_count);
+			return false;
+		}
+
+		// 新注册分配新的代数，0保留给未注册状态
+		uint16_t gen = fd_info->gen;
+		if (mode == EPOLL_CTL_ADD) {
+			gen = fd_info->gen + 1 ? fd_info->gen + 1 : 1;
+		}
+		assert(((uintptr_t)chan.get() & ~EPOLL_TAG_PTR_MASK) == 0);
+
+		struct epoll_event ev;
+		memset(&ev, 0, sizeof(ev));
+		ev.data.u64 = epoll_make_tag(chan.get(), gen);
+		if (events & EPOLL_RECV) {
+			ev.events |= EPOLLIN;	
+		}
+		if (events & EPOLL_SEND) {
+			ev.events |= EPOLLOUT;
+		}
+		if (mode == EPOLL_CTL_ADD && edge) {
+			ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+		}
+
+		// 注册后loop可能立即收到事件，代数与触发模式需先于epoll_ctl写入
+		if (mode == EPOLL_CTL_ADD) {
+			chan->_is_edge = edge;
+			chan->_gen.store(gen, memory_order_release);
+		}
+
+		auto ret = uring ? 0 : epoll_ctl(epoll_id, mode, fd, &ev);
+		if (ret == -1) {
+			printf(
+				"[%d] %s|epoll_ctl fail, epoll_id:%d, fd:%d, mode:%d, error:%s\n", 
+				gettid(),
+				__FUNCTION__,
+				epoll_id,
+				fd,
+				mode,
+				strerror(errno)
+			);
+			if (mode == EPOLL_CTL_ADD) {
+				chan->_gen.store(0, memory_order_release);
+				_fd_count--;
+			}
+			return false;
+		}
+	//	printf("DEBUG|epoll_ctl, ret:%d, epoll_id:%d, fd:%d, events:%d\n", ret, epoll_id, fd, ev.events);
+
+		fd_info->events = events;
+		if (mode == EPOLL_CTL_ADD) {
+			fd_info->gen = gen;
+			fd_info->owner = chan;
+			fd_info->chan.store(chan.get(), memory_order_release);
+			info.conn_count++;
+		}
 	}
-	if (events & EPOLL_SEND) {
-		ev.events |= EPOLLOUT;
+
+	// io_uring的提交只能在所属loop线程进行
+	if (uring) {
+		uring_arm_async(index, chan);
 	}
+	return true;
+}
+
+bool EpollEngine::del(shared_ptr<EpollChannel> chan)
+{
+	return remove(chan.get());
+}
 
-	auto mode = _fd_infos.find(fd) != _fd_infos.end() ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
-	if (mode == EPOLL_CTL_ADD && (int)_fd_infos.size() > _max_count) {
-		printf("[%d] %s|cur_count:%ld >= _max_count:%d\n", gettid(), __FUNCTION__, _fd_infos.size(), _max_count);
+bool EpollEngine::remove(EpollChannel* chan)
+{
+	auto fd = chan->get_fd();
+	auto fd_info = _fd_table->get(fd);
+	if (!fd_info) {
 		return false;
 	}
 
-	auto ret = epoll_ctl(epoll_id, mode, fd, &ev);
-	if (ret == -1) {
-		printf(
-			"[%d] %s|epoll_ctl fail, epoll_id:%d, fd:%d, mode:%d, error:%s\n", 
-			gettid(),
-			__FUNCTION__,
-			epoll_id,
-			fd,
-			mode,
-            strerror(errno)
-		);
+	auto& info = *_epoll_infos[get_loop_index(chan)];
+
+	lock_guard<mutex> lock(info.lock);
+	if (fd_info->chan.load(memory_order_relaxed) != chan) {
 		return false;
 	}
-//	printf("DEBUG|epoll_ctl, ret:%d, epoll_id:%d, fd:%d, events:%d\n", ret, epoll_id, fd, ev.events);
-
-	_fd_infos[fd] = {fd, epoll_id, chan};
 
+	bool uring = _backend == EPOLL_BACKEND_URING;
+	auto ret = uring ? 0 : epoll_ctl(info.epoll_id, EPOLL_CTL_DEL, fd, NULL);
+	if (ret == -1) {
+		return false;
+	}
+	if (uring) {
+		// 取消在途请求，请求持有channel引用，全部完成后fd才会关闭
+		auto owner = fd_info->owner;
+		auto index = get_loop_index(chan);
+		if (get_current_loop() == index) {
+			uring_cancel(info, owner);
+		} else {
+			post(index, [this, index, owner] {
+				uring_cancel(*_epoll_infos[index], owner);
+			});
+		}
+	}
+	chan->_gen.store(0, memory_order_release);
+	fd_info->chan.store(NULL, memory_order_release);
+	fd_info->events = 0;
+	info.retired.push_back(std::move(fd_info->owner));
+	info.conn_count--;
+	_fd_count--;
 	return true;
 }
 
-bool EpollEngine::del(shared_ptr<EpollChannel> chan)
+void EpollEngine::release_retired(EpollInfo& info)
 {
-	int epoll_id;
+	vector<shared_ptr<EpollChannel>> retired;
 	{
-		lock_guard<mutex> lock(_mutex);
-		auto iter = _fd_infos.find(chan->get_fd());
-		if (iter == _fd_infos.end()) {
-			return false;
+		lock_guard<mutex> lock(info.lock);
+		if (info.retired.empty()) {
+			return ;
 		}
-		epoll_id = iter->second.epoll_id;
+		retired.swap(info.retired);
+	}
+	// channel析构(close fd)放在锁外
+	retired.clear();
+}
+
+bool EpollEngine::post(int index, EpollTask task)
+{
+	if (index < 0 || index >= _thread_count) {
+		return false;
+	}
+	// 先登记再检查终止标记：terminate置标记后等待登记归零才通知loop退出，
+	// 因此要么看到终止返回false，要么入队的任务一定在loop退出前被取走
+	_posting.fetch_add(1);
+	if (_terminate) {
+		_posting.fetch_sub(1);
+		return false;
+	}
+	auto& info = *_epoll_infos[index];
+	info.tasks.push(std::move(task));
+	wakeup(info);
+	_posting.fetch_sub(1);
+	return true;
+}
+
+bool EpollEngine::post(shared_ptr<EpollChannel> chan, EpollTask task)
+{
+	return post(get_loop_index(chan.get()), std::move(task));
+}
+
+void EpollEngine::wakeup(EpollInfo& info)
+{
+	// 已有未处理的唤醒时不再写eventfd，多次post合并为一次唤醒
+	if (info.wakeup_pending.exchange(true, memory_order_acq_rel)) {
+		return ;
+	}
+	uint64_t one = 1;
+	while (write(info.event_fd, &one, sizeof(one)) == -1 && errno == EINTR) {
+		;
+	}
+}
+
+void EpollEngine::run_tasks(EpollInfo& info)
+{
+	uint64_t value;
+	while (read(info.event_fd, &value, sizeof(value)) == -1 && errno == EINTR) {
+		;
+	}
+	// 先清标记再取任务，清标记之后的post都会重新唤醒
+	info.wakeup_pending.exchange(false, memory_order_acq_rel);
+
+	int count = 0;
+	EpollTask task;
+	while (count < EPOLL_TASK_BATCH && info.tasks.pop(task)) {
+		task();
+		task = nullptr;
+		count++;
+	}
+	// 单轮任务数达到上限，让出给io事件，下一轮继续
+	if (count == EPOLL_TASK_BATCH) {
+		wakeup(info);
+	}
+}
+
+void EpollEngine::drain_tasks(EpollInfo& info)
+{
+	EpollTask task;
+	while (info.tasks.pop(task)) {
+		task();
+		task = nullptr;
+	}
+}
+
+uint64_t EpollEngine::monotonic_ms()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+EpollTimerId EpollEngine::run_after(int index, uint64_t delay_ms, EpollTimerFunc func)
+{
+	return add_timer(index, delay_ms, 0, std::move(func));
+}
+
+EpollTimerId EpollEngine::run_every(int index, uint64_t interval_ms, EpollTimerFunc func)
+{
+	return add_timer(index, interval_ms, interval_ms, std::move(func));
+}
+
+bool EpollEngine::cancel(int index, EpollTimerId id)
+{
+	if (get_current_loop() != index) {
+		printf("[%d] %s|not in loop thread, index:%d\n", gettid(), __FUNCTION__, index);
+		return false;
+	}
+	return _epoll_infos[index]->timers->cancel(id);
+}
+
+EpollTimerId EpollEngine::add_timer(int index, uint64_t delay_ms, uint64_t interval_ms, EpollTimerFunc func)
+{
+	if (get_current_loop() != index) {
+		printf("[%d] %s|not in loop thread, index:%d\n", gettid(), __FUNCTION__, index);
+		return 0;
+	}
+	auto& info = *_epoll_infos[index];
+	auto id = info.timers->add(monotonic_ms(), delay_ms, interval_ms, std::move(func));
+	// 只有早于已设置的到期点时才需要重设timerfd
+	auto tick = info.timers->expire_tick(id);
+	if (info.timer_tick == 0 || tick < info.timer_tick) {
+		arm_timer(info, tick);
+	}
+	return id;
+}
+
+void EpollEngine::run_timers(EpollInfo& info)
+{
+	uint64_t value;
+	while (read(info.timer_fd, &value, sizeof(value)) == -1 && errno == EINTR) {
+		;
 	}
+	// 回调中新增的定时器可能已设置过timerfd，这里统一按最早的到期点重设
+	info.timer_tick = 0;
+	info.timers->advance(monotonic_ms());
+	arm_timer(info, info.timers->next_tick());
+}
 
-	auto ret = epoll_ctl(epoll_id, EPOLL_CTL_DEL, chan->get_fd(), NULL);
-	if (!ret) {
-		lock_guard<mutex> lock(_mutex);
-		_fd_infos.erase(chan->get_fd());
+bool EpollEngine::arm_timer(EpollInfo& info, uint64_t tick)
+{
+	struct itimerspec its;
+	memset(&its, 0, sizeof(its));
+	if (tick > 0) {
+		auto ms = tick * info.timers->tick_ms();
+		its.it_value.tv_sec = ms / 1000;
+		its.it_value.tv_nsec = (ms % 1000) * 1000000L;
+	}
+	if (timerfd_settime(info.timer_fd, TFD_TIMER_ABSTIME, &its, NULL) == -1) {
+		printf("[%d] %s|timerfd_settime fail, error:%s\n", gettid(), __FUNCTION__, strerror(errno));
+		return false;
 	}
-	return !ret ? true : false;
+	info.timer_tick = tick;
+	return true;
 }
 
 void EpollEngine::terminate()
@@ -99,31 +400,86 @@ void EpollEngine::terminate()
 
 	printf("EpollEngine|terminate\n");
 
+	// 等正在进行的post入队完成，此后不会再有任务入队
+	while (_posting.load() > 0) {
+		this_thread::yield();
+	}
+	_stop = true;
+
     for (auto& item : _epoll_infos) {
-        close(item.pipes[0]);
-        close(item.pipes[1]);
+		item->wakeup_pending.store(false);
+		wakeup(*item);
     }
     for (auto& item : _threads) {
         item.join();
     }
 
-	for (auto& item : _fd_infos) {
-		close(item.second.chan->get_fd());
+	// 释放引擎持有的channel引用，最后一个引用析构时关闭fd
+	for (int fd = 0; fd < _fd_table->max_fd(); fd++) {
+		auto fd_info = _fd_table->get(fd);
+		if (fd_info && fd_info->chan.load(memory_order_relaxed)) {
+			fd_info->owner->release();
+			fd_info->chan.store(NULL, memory_order_relaxed);
+			fd_info->owner.reset();
+		}
 	}
 	for (auto& item : _epoll_infos) {
-		close(item.epoll_id);
+		while (item->ops.next != &item->ops) {
+			auto op = item->ops.next;
+			item->ops.next = op->next;
+			if (op->kind == URING_OP_SEND) {
+				delete static_cast<EpollUringSendOp*>(op);
+			} else {
+				delete op;
+			}
+		}
+		while (item->free_sends) {
+			auto op = item->free_sends;
+			item->free_sends = op->next;
+			delete static_cast<EpollUringSendOp*>(op);
+		}
+		delete item->ring;
+		item->ring = NULL;
+		item->retired.clear();
+		close(item->epoll_id);
+		close(item->event_fd);
+		close(item->timer_fd);
+		free(item->events);
+		delete item->timers;
+		item->timers = NULL;
 	}
+	_fd_count = 0;
 }
 
 int EpollEngine::get_fd_count()
 {
-	lock_guard<mutex> lock(_mutex);
-	return (int)_fd_infos.size();
+	return _fd_count.load();
+}
+
+int64_t EpollEngine::get_buffer_bytes()
+{
+	int64_t bytes = 0;
+	for (auto& item : _epoll_infos) {
+		bytes += item->buffer_bytes.load(memory_order_relaxed);
+	}
+	return bytes;
 }
 
 bool EpollEngine::create_epoll_info(EpollInfo& info)
 {
-    memset(&info, 0, sizeof(info));
+    info.epoll_id = -1;
+    info.event_fd = -1;
+    info.timer_fd = -1;
+    info.events = NULL;
+    info.timers = NULL;
+    info.timer_tick = 0;
+    info.ring = NULL;
+    info.ops.prev = info.ops.next = &info.ops;
+    info.free_sends = NULL;
+    info.free_send_count = 0;
+    info.conn_count = 0;
+    info.buffer_bytes = 0;
+    info.wakeup_pending = false;
     bool flag = false;
     do {
         info.epoll_id = epoll_create(_max_count);
@@ -131,10 +487,31 @@ bool EpollEngine::create_epoll_info(EpollInfo& info)
 			printf("%s|epoll_create fail\n", __FUNCTION__);
             break ;
         }
-        if (pipe(info.pipes) == -1) {
-			printf("%s|pipe fail\n", __FUNCTION__);
+        info.event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (info.event_fd == -1) {
+			printf("%s|eventfd fail\n", __FUNCTION__);
+            break ;
+        }
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.u64 = EPOLL_TAG_WAKEUP;
+        if (epoll_ctl(info.epoll_id, EPOLL_CTL_ADD, info.event_fd, &ev) == -1) {
+			printf("%s|epoll_ctl eventfd fail, error:%s\n", __FUNCTION__, strerror(errno));
             break ;
         }
+        info.timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (info.timer_fd == -1) {
+			printf("%s|timerfd_create fail\n", __FUNCTION__);
+            break ;
+        }
+        ev.data.u64 = EPOLL_TAG_TIMER;
+        if (epoll_ctl(info.epoll_id, EPOLL_CTL_ADD, info.timer_fd, &ev) == -1) {
+			printf("%s|epoll_ctl timerfd fail, error:%s\n", __FUNCTION__, strerror(errno));
+            break ;
+        }
+        info.timers = new EpollTimerWheel(EPOLL_TIMER_TICK_MS, EPOLL_TIMER_SLOTS);
+        info.timers->reset(monotonic_ms());
         info.events = (struct epoll_event*)malloc(_max_count * sizeof(struct epoll_event));
         if (!info.events) {
 			printf("%s|malloc events fail\n", __FUNCTION__);
@@ -142,12 +519,11 @@ bool EpollEngine::create_epoll_info(EpollInfo& info)
         }
         flag = true;
        // printf(
-       //     "%s|ptr:%p, epoll_id:%d, pipe[0]:%d, pipe[1]:%d\n", 
+       //     "%s|ptr:%p, epoll_id:%d, event_fd:%d\n", 
        //     __FUNCTION__, 
        //     this, 
        //     info.epoll_id, 
-       //     info.pipes[0],
-       //     info.pipes[1]
+       //     info.event_fd
        // );
     } while (0);
 
@@ -155,11 +531,11 @@ bool EpollEngine::create_epoll_info(EpollInfo& info)
         if (info.epoll_id > 0) {
             close(info.epoll_id);
         }
-        if (info.pipes[0] > 0) {
-            close(info.pipes[0]);
+        if (info.event_fd > 0) {
+            close(info.event_fd);
         }
-        if (info.pipes[1] > 0) {
-            close(info.pipes[1]);
+        if (info.timer_fd > 0) {
+            close(info.timer_fd);
         }
     }
     return flag; 
@@ -169,8 +545,8 @@ bool EpollEngine::create_epoll_infos()
 {
     int i = 0;
     for (; i < _thread_count; i++) {
-        EpollInfo info;
-        if (!create_epoll_info(info)) {
+        auto info = make_shared<EpollInfo>();
+        if (!create_epoll_info(*info)) {
 			printf("%s|create_epoll_info fail, i:%d\n", __FUNCTION__, i);
             break ;
         }
@@ -178,9 +554,11 @@ bool EpollEngine::create_epoll_infos()
     }
     if (i != _thread_count) {
         for (auto& item : _epoll_infos) {
-            close(item.epoll_id);
-            close(item.pipes[0]);
-            close(item.pipes[1]);
+            close(item->epoll_id);
+            close(item->event_fd);
+            close(item->timer_fd);
+            free(item->events);
+            delete item->timers;
         }
         _epoll_infos.clear();
         return false;
@@ -190,9 +568,17 @@ bool EpollEngine::create_epoll_infos()
 
 void EpollEngine::run(int index)
 {
+	if (_backend == EPOLL_BACKEND_URING) {
+		run_uring(index);
+		return ;
+	}
+
 	bool running = true;
-	EpollInfo& info = _epoll_infos[index];
+	EpollInfo& info = *_epoll_infos[index];
+	t_engine = this;
+	t_loop_index = index;
 	while (running) {
+		release_retired(info);
 		auto count = epoll_wait(info.epoll_id, info.events, _max_count, -1);
 	//	printf("DEBUG|epoll_wait.after, ret:%d\n", count);
 		if (count == -1 && errno != EINTR) {
@@ -202,37 +588,50 @@ void EpollEngine::run(int index)
 
 			auto& ev = info.events[i];
 
-			auto iter = _fd_infos.find(ev.data.fd);
-			assert(iter != _fd_infos.end());
+			if (ev.data.u64 == EPOLL_TAG_WAKEUP) {
+				run_tasks(info);
+				if (_stop) {
+					drain_tasks(info);
+					running = false;
+					break ;
+				}
+				continue ;
+			}
+			if (ev.data.u64 == EPOLL_TAG_TIMER) {
+				run_timers(info);
+				continue ;
+			}
+
+			auto chan = epoll_tag_chan(ev.data.u64);
+
+			// 本轮中已被del或重新注册的channel，代数不再匹配，直接跳过；
+			// channel内存由retired保证在本轮内有效
+			if (chan->_gen.load(memory_order_acquire) != epoll_tag_gen(ev.data.u64)) {
+				continue ;
+			}
 
 			bool revent = false;
 			bool wevent = false;
 
-			// 这里先不考虑EPOLLRDHUP用于处理关闭事件
+			// EPOLLRDHUP按可读处理，由recv返回0走关闭流程；
+			// 边缘触发下同一事件可能同时可读可写，两者都要处理
 			if (ev.events & EPOLLERR) {
 				revent = wevent = true;
 			} else if ((ev.events & EPOLLHUP) && !(ev.events & EPOLLRDHUP)) {
 				revent = wevent = true;
-			} else if (ev.events & EPOLLIN) {
-				revent = true;
-			} else if (ev.events & EPOLLOUT) {
-				wevent = true;
+			} else {
+				revent = ev.events & (EPOLLIN | EPOLLRDHUP);
+				wevent = ev.events & EPOLLOUT;
 			}
 
-			if (ev.data.fd == info.pipes[1]) {
-				running = false;
-				break ;
-			} else {
-				auto chan = iter->second.chan;
-				if (revent && !chan->is_released()) {
-					chan->on_recv();
-				}
-				if (wevent && !chan->is_released()) {
-					chan->on_send();
-				}
-				if (chan->is_released()) {
-					del(chan);
-				}
+			if (revent && !chan->is_released()) {
+				chan->on_recv();
+			}
+			if (wevent && !chan->is_released()) {
+				chan->on_send();
+			}
+			if (chan->is_released()) {
+				remove(chan);
 			}
 		}
 	}
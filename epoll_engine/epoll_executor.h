@@ -1,9 +1,12 @@
 #ifndef __EPOLL_EXECUTOR_H__
 #define __EPOLL_EXECUTOR_H__
 
+#include <stdint.h>
 #include <sys/epoll.h>
+#include <sys/socket.h>
 
 #include <mutex>
+#include <atomic>
 #include <thread>
 #include <memory>
 #include <functional>
@@ -12,22 +15,185 @@
 #include <vector>
 
 #include "epoll_channel.h"
+#include "epoll_uring.h"
+#include "../mpsc_queue.h"
 
 using namespace std;
 
+const int EPOLL_DEF_MAX_FD = 65536;
+
+const int EPOLL_MAX_FD = (1 << 24);
+
+// 每轮epoll_wait最多执行的post任务数
+const int EPOLL_TASK_BATCH = 1024;
+
+// loop时间轮的刻度与槽位数，单圈覆盖约40s
+const int EPOLL_TIMER_TICK_MS = 10;
+
+const int EPOLL_TIMER_SLOTS = 4096;
+
+// epoll_event.data(及io_uring user_data)的保留值，标识loop内部fd
+const uint64_t EPOLL_TAG_WAKEUP = 0;
+
+const uint64_t EPOLL_TAG_TIMER = 1;
+
+const uint64_t EPOLL_TAG_CANCEL = 2;
+
+enum EpollBackend
+{
+	EPOLL_BACKEND_EPOLL = 0,
+	EPOLL_BACKEND_URING,		// 内核不支持io_uring时回退epoll
+};
+
+// io_uring后端每个loop的SQ深度与provided buffer ring规格
+const int EPOLL_URING_ENTRIES = 4096;
+
+const int EPOLL_URING_BUF_COUNT = 256;
+
+const int EPOLL_URING_BUF_SIZE = (1024 * 16);
+
+enum EpollUringOpKind
+{
+	URING_OP_RECV = 0,		// 多路recv，数据直接回调on_recv(data, size)
+	URING_OP_POLL_IN,		// 多路poll，回调on_recv()
+	URING_OP_POLL_OUT,		// 单次poll，回调on_send()，用于未建立的连接与非连接channel
+	URING_OP_ACCEPT,		// 多路accept，交给EpollChannelServer::accept_fd
+	URING_OP_SEND,			// 单次sendmsg，直接发送连接发送队列中的slice
+};
+
+// 单个sendmsg请求最多携带的slice数
+const int URING_SEND_IOV = 64;
+
+// 每个loop缓存的空闲sendmsg请求数上限
+const int URING_SEND_CACHE = 256;
+
+enum EpollUringFlag
+{
+	URING_RECV_ARMED = 0x1,
+	URING_SEND_ARMED = 0x2,
+	URING_POLL_RECV  = 0x4,		// 内核不支持多路recv，改用poll
+	URING_POLL_ACCEPT = 0x8,	// 多路accept出现不可恢复的错误，改用poll后由on_recv()accept
+};
+
+// 一个已提交的io_uring请求，持有channel引用直到最后一个完成事件，
+// 保证取消或关闭过程中的完成事件不会访问已释放的channel
+struct EpollUringOp
+{
+	shared_ptr<EpollChannel>	chan;
+	uint16_t	gen;
+	int			kind;
+
+	EpollUringOp*	prev;
+	EpollUringOp*	next;
+};
+
+// sendmsg请求，参数须保持到完成事件，iov随请求一起分配；
+// 完成后回收到所属loop的空闲链表，稳定运行时发送不分配内存
+struct EpollUringSendOp : public EpollUringOp
+{
+	struct msghdr	msg;
+	struct iovec	iov[URING_SEND_IOV];
+};
+
+typedef function<void()> EpollTask;
+
+// epoll_event.data: 低48位为EpollChannel指针，高16位为注册代数
+// 用于识别channel被del(或重新注册)后同一批次中残留的旧事件
+const int EPOLL_TAG_GEN_SHIFT = 48;
+
+const uint64_t EPOLL_TAG_PTR_MASK = ((uint64_t)1 << EPOLL_TAG_GEN_SHIFT) - 1;
+
+inline uint64_t epoll_make_tag(EpollChannel* chan, uint16_t gen)
+{
+	return (uint64_t)(uintptr_t)chan | ((uint64_t)gen << EPOLL_TAG_GEN_SHIFT);
+}
+
+inline EpollChannel* epoll_tag_chan(uint64_t tag)
+{
+	return (EpollChannel*)(uintptr_t)(tag & EPOLL_TAG_PTR_MASK);
+}
+
+inline uint16_t epoll_tag_gen(uint64_t tag)
+{
+	return (uint16_t)(tag >> EPOLL_TAG_GEN_SHIFT);
+}
+
 struct EpollInfo
 {
     int epoll_id;
-    int pipes[2];
+    int event_fd;
+    int timer_fd;
     struct epoll_event* events;
+
+	// 仅由本loop线程访问，timerfd以绝对时间单次定时到最早的到期tick，0表示未设置
+	EpollTimerWheel*	timers;
+	uint64_t			timer_tick;
+
+	// io_uring后端，仅由本loop线程访问；ops为在途请求链表的哨兵
+	IoUring*		ring;
+	EpollUringOp	ops;
+
+	// 空闲的sendmsg请求，以next串联
+	EpollUringOp*	free_sends;
+	int				free_send_count;
+
+	// 本loop线程上set触发的重新提交，推迟到下次io_uring_enter前处理，
+	// 避免在channel的_mutex内进入uring_arm(sendmsg准备时需加同一把锁)
+	vector<shared_ptr<EpollChannel>>	arm_pending;
+
+	// 跨线程投递到本loop的任务，由eventfd唤醒
+	MpscQueue<EpollTask>	tasks;
+	atomic<bool>			wakeup_pending;
+
+	// 保护本loop所属fd的写操作(set/del)以及retired
+	mutex	lock;
+	atomic<int>	conn_count;
+
+	// 归属本loop的channel缓冲区占用字节数，按loop分开计数避免跨loop争用
+	atomic<int64_t>	buffer_bytes;
+
+	// 已del的channel延迟到下一轮epoll_wait前释放，保证本轮事件中的裸指针有效
+	vector<shared_ptr<EpollChannel>>	retired;
 };
 
+// fd索引的channel槽位，loop线程无锁读取chan，写操作由所属loop的lock串行化
 struct EpollFdInfo
 {
-	int fd;
-    int epoll_id;
+	atomic<EpollChannel*>		chan;
+	shared_ptr<EpollChannel>	owner;
+	int		events;
+	uint16_t	gen;
+};
+
+// 两级fd表，chunk按需分配且不会迁移，读端不需要加锁
+class EpollFdTable
+{
+public:
+	enum {
+		CHUNK_BITS = 10,
+		CHUNK_SIZE = 1 << CHUNK_BITS,
+	};
+
+	EpollFdTable(int max_fd);
+	~EpollFdTable();
 
-	shared_ptr<EpollChannel> chan;
+	EpollFdInfo* get(int fd) {
+		if (fd < 0 || fd >= _max_fd) {
+			return NULL;
+		}
+		auto chunk = _chunks[fd >> CHUNK_BITS].load(memory_order_acquire);
+		return chunk ? &chunk[fd & (CHUNK_SIZE - 1)] : NULL;
+	}
+
+	EpollFdInfo* get_or_create(int fd);
+
+	int max_fd() {return _max_fd;}
+
+private:
+	int _max_fd;
+	int _chunk_count;
+
+	atomic<EpollFdInfo*>*	_chunks;
 };
 
 class EpollChannel;
@@ -35,7 +201,7 @@ class EpollChannel;
 class EpollEngine : public enable_shared_from_this<EpollEngine>
 {
 public:
-    EpollEngine(int thread_count, int max_conn_count);
+    EpollEngine(int thread_count, int max_conn_count, EpollBackend backend = EPOLL_BACKEND_EPOLL);
     ~EpollEngine();
 
     bool set(shared_ptr<EpollChannel> chan, int events = EPOLL_RECV);
@@ -43,31 +209,123 @@ public:
 
     void terminate();
 
+	// 投递任务到指定loop(或channel所属loop)执行，可在任意线程调用，
+	// 多次投递合并为一次eventfd唤醒；引擎已终止时返回false，返回true的任务在loop退出前一定执行
+	bool post(int index, EpollTask task);
+	bool post(shared_ptr<EpollChannel> chan, EpollTask task);
+
+	// 以下定时器接口只能在index对应的loop线程调用(其他线程可通过post转入)，
+	// 回调在该loop线程执行；非loop线程调用返回0/false
+	EpollTimerId run_after(int index, uint64_t delay_ms, EpollTimerFunc func);
+	EpollTimerId run_every(int index, uint64_t interval_ms, EpollTimerFunc func);
+	bool cancel(int index, EpollTimerId id);
+
 	int get_fd_count();
 
+	int get_thread_count() {return _thread_count;}
+
+	// 实际使用的后端，请求io_uring但内核不支持时为EPOLL_BACKEND_EPOLL
+	EpollBackend get_backend() {return _backend;}
+
+	// 注册前设置，边缘触发下channel注册一次EPOLLIN|EPOLLOUT|EPOLLRDHUP|EPOLLET，
+	// 之后不再epoll_ctl，读写均进行到EAGAIN
+	void set_edge_triggered(bool on) {_edge_triggered = on;}
+
+	bool is_edge_triggered() {return _edge_triggered;}
+
+	// loop上已注册的channel数
+	int get_loop_load(int index) {return _epoll_infos[index]->conn_count.load(memory_order_relaxed);}
+
+	// 所有channel收发缓冲区当前占用的字节数(接收block容量与待发送数据)
+	int64_t get_buffer_bytes();
+
+	// 由channel在缓冲区占用变化时调用
+	void add_buffer_bytes(EpollChannel* chan, int64_t delta) {
+		_epoll_infos[get_loop_index(chan)]->buffer_bytes.fetch_add(delta, memory_order_relaxed);
+	}
+
+	// 当前线程为本引擎的loop线程时返回其下标，否则返回-1
+	int get_current_loop() {return t_engine == this ? t_loop_index : -1;}
+
+	int get_loop_index(EpollChannel* chan) {
+		auto index = chan->get_loop_index();
+		return index >= 0 ? index % _thread_count : chan->get_fd() % _thread_count;
+	}
+
 private:
     bool create_epoll_info(EpollInfo& info);
     bool create_epoll_infos();
-    
+
     void run(int index);
 
+	bool remove(EpollChannel* chan);
+
+	void release_retired(EpollInfo& info);
+
+	void wakeup(EpollInfo& info);
+
+	void run_tasks(EpollInfo& info);
+
+	// loop退出前执行队列中剩余的全部任务
+	void drain_tasks(EpollInfo& info);
+
+	EpollTimerId add_timer(int index, uint64_t delay_ms, uint64_t interval_ms, EpollTimerFunc func);
+
+	void run_timers(EpollInfo& info);
+
+	// 将timerfd设置到tick对应的时间，tick为0时停止
+	bool arm_timer(EpollInfo& info, uint64_t tick);
+
+	static uint64_t monotonic_ms();
+
+	bool create_urings();
+
+	void run_uring(int index);
+
+	void uring_arm(EpollInfo& info, shared_ptr<EpollChannel> chan);
+
+	void uring_arm_async(int index, shared_ptr<EpollChannel> chan);
+
+	void uring_submit(EpollInfo& info, shared_ptr<EpollChannel> chan, int kind);
+
+	// sendmsg请求优先从空闲链表取，释放时放回，超过URING_SEND_CACHE才归还内存
+	EpollUringSendOp* uring_alloc_send(EpollInfo& info);
+
+	void uring_free_op(EpollInfo& info, EpollUringOp* op);
+
+	void uring_poll_internal(EpollInfo& info, int fd, uint64_t tag);
+
+	void uring_cancel(EpollInfo& info, shared_ptr<EpollChannel> chan);
+
+	void uring_complete(EpollInfo& info, int index, const struct io_uring_cqe& cqe);
+
+	struct io_uring_sqe* uring_get_sqe(EpollInfo& info);
+
 	string event_desc(int events);
 
 private:
-    bool _terminate;
+    atomic<bool> _terminate;
+	// 正在post的线程数，terminate等其归零后置_stop通知loop退出
+	atomic<int>	_posting;
+	atomic<bool> _stop;
+	bool _edge_triggered;
+
+	EpollBackend	_backend;
 
     int _max_count;
 
-	int _timer_fd;
 	int _thread_count;
 
-	map<int, EpollFdInfo> _fd_infos;
+	atomic<int>		_fd_count;
+	EpollFdTable*	_fd_table;
 
     mutex   _mutex;
 
     vector<thread>      _threads;
-    vector<EpollInfo>   _epoll_infos;
+    vector<shared_ptr<EpollInfo>>   _epoll_infos;
+
+	static thread_local EpollEngine*	t_engine;
+	static thread_local int				t_loop_index;
 };
 
 #endif
-
@@ -0,0 +1,162 @@
+#ifndef __EPOLL_SEND_QUEUE_H__
+#define __EPOLL_SEND_QUEUE_H__
+
+#include <limits.h>
+#include <sys/uio.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+// 单次writev最多提交的slice数
+const int SEND_IOV_MAX = IOV_MAX;
+
+// 不超过该大小的拷贝发送合并进队尾slice，避免小包各自分配
+const size_t SEND_COALESCE_SIZE = 1024 * 4;
+
+const size_t SEND_COALESCE_LIMIT = 1024 * 64;
+
+// 发送队列，由引用计数的数据片组成，writev直接从各片取数据，
+// 大块数据无需拷贝进连接缓冲区；部分写按片记录偏移。非线程安全，由channel的_mutex保护。
+// 片容器在首次入队时分配、发空后释放，空闲连接不占用内存
+class EpollSendQueue
+{
+public:
+	EpollSendQueue() {
+		_bytes = 0;
+		_sealed = 0;
+	}
+
+	// 拷贝发送，小数据合并到队尾可追加的slice
+	void push(const char* data, size_t size) {
+		if (size == 0) {
+			return ;
+		}
+		if (size <= SEND_COALESCE_SIZE && _slices && (int)_slices->size() > _sealed) {
+			auto& tail = _slices->back();
+			if (!tail.ref && tail.own.size() + size <= SEND_COALESCE_LIMIT) {
+				tail.own.append(data, size);
+				_bytes += size;
+				return ;
+			}
+		}
+		slices().emplace_back();
+		_slices->back().own.assign(data, size);
+		_bytes += size;
+	}
+
+	// 接管调用方的string，不拷贝
+	void push(string&& data) {
+		if (data.empty()) {
+			return ;
+		}
+		_bytes += data.size();
+		slices().emplace_back();
+		_slices->back().own = std::move(data);
+	}
+
+	// 共享只读数据，可同时发送给多个连接
+	void push(shared_ptr<const string> data) {
+		if (!data || data->empty()) {
+			return ;
+		}
+		_bytes += data->size();
+		slices().emplace_back();
+		_slices->back().ref = std::move(data);
+	}
+
+	// 从队首开始填充iov，返回填充的个数
+	int fill(struct iovec* iov, int max) {
+		int count = 0;
+		if (!_slices) {
+			return 0;
+		}
+		for (auto it = _slices->begin(); it != _slices->end() && count < max; ++it) {
+			iov[count].iov_base = (void*)it->data();
+			iov[count].iov_len = it->size();
+			count++;
+		}
+		return count;
+	}
+
+	// 队首count个slice已交给内核异步发送，完成前不再向其追加数据；完成后以0解除
+	void seal(int count) {_sealed = count;}
+
+	// 确认已发送size字节，发完的slice立即释放
+	void consume(size_t size) {
+		_bytes -= size;
+		while (size > 0) {
+			auto& head = _slices->front();
+			auto left = head.size();
+			if (size < left) {
+				head.offset += size;
+				return ;
+			}
+			size -= left;
+			_slices->pop_front();
+		}
+		if (_bytes == 0) {
+			_slices.reset();
+		}
+	}
+
+	// 回退到入队前的字节数，用于入队后注册事件失败
+	void truncate(size_t bytes) {
+		while (_bytes > bytes) {
+			auto& tail = _slices->back();
+			auto drop = _bytes - bytes;
+			if (!tail.ref && drop < tail.size()) {
+				tail.own.resize(tail.own.size() - drop);
+				_bytes = bytes;
+				return ;
+			}
+			_bytes -= tail.size();
+			_slices->pop_back();
+		}
+		if (_bytes == 0) {
+			_slices.reset();
+		}
+	}
+
+	void clear() {
+		_slices.reset();
+		_bytes = 0;
+	}
+
+	bool empty() {return _bytes == 0;}
+
+	size_t bytes() {return _bytes;}
+
+	size_t count() {return _slices ? _slices->size() : 0;}
+
+private:
+	struct Slice
+	{
+		shared_ptr<const string>	ref;
+		string	own;
+		size_t	offset = 0;
+
+		const char* data() const {
+			return (ref ? ref->data() : own.data()) + offset;
+		}
+
+		size_t size() const {
+			return (ref ? ref->size() : own.size()) - offset;
+		}
+	};
+
+	deque<Slice>& slices() {
+		if (!_slices) {
+			_slices.reset(new deque<Slice>);
+		}
+		return *_slices;
+	}
+
+	unique_ptr<deque<Slice>>	_slices;
+	size_t						_bytes;
+	int							_sealed;
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef __EPOLL_TIMER_EXECUTOR_H__
+#define __EPOLL_TIMER_EXECUTOR_H__
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "../timer.h"
+#include "epoll_executor.h"
+
+using namespace std;
+
+// 将Timer的到期回调投递到EpollEngine的指定loop执行，每批一次post，
+// 回调可直接操作该loop上的channel。引擎须在Timer析构后再终止；
+// 已终止时post失败，或投递的闭包未执行就被销毁，整批丢弃并计数，
+// 回调不在到期线程代为执行，避免在loop之外操作channel
+class EpollTimerExecutor : public TimerExecutor
+{
+public:
+	EpollTimerExecutor(shared_ptr<EpollEngine> engine, int index) {
+		_engine = engine;
+		_index = index;
+		_dropped = 0;
+	}
+
+	void execute(std::vector<TimerTask>& batch) override {
+		auto tasks = make_shared<Batch>(batch, _dropped);
+		_engine->post(_index, [tasks]() {
+			tasks->run();
+		});
+	}
+
+	// 未执行而被丢弃的回调数
+	size_t get_dropped() {
+		return _dropped.load();
+	}
+
+private:
+	// 随投递的闭包一起销毁，未执行过时逐个discard，Timer的析构等待因此总能结束
+	class Batch
+	{
+	public:
+		Batch(std::vector<TimerTask>& batch, atomic<size_t>& dropped) : _dropped(dropped) {
+			_tasks.swap(batch);
+			_done = false;
+		}
+
+		~Batch() {
+			if (_done) {
+				return ;
+			}
+			// 最后一个discard之后Timer与执行器都可能已析构，先计数
+			_dropped.fetch_add(_tasks.size());
+			for (auto& task : _tasks) {
+				task.discard();
+			}
+		}
+
+		void run() {
+			_done = true;
+			for (auto& task : _tasks) {
+				task();
+			}
+		}
+
+	private:
+		std::vector<TimerTask>	_tasks;
+		atomic<size_t>&	_dropped;
+		bool	_done;
+	};
+
+private:
+	shared_ptr<EpollEngine>	_engine;
+	int		_index;
+	atomic<size_t>	_dropped;
+};
+
+#endif
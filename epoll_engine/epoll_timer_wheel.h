@@ -0,0 +1,293 @@
+#ifndef __EPOLL_TIMER_WHEEL_H__
+#define __EPOLL_TIMER_WHEEL_H__
+
+#include <stdint.h>
+
+#include <vector>
+#include <functional>
+
+using namespace std;
+
+typedef uint64_t EpollTimerId;
+
+typedef function<void()> EpollTimerFunc;
+
+// 单线程哈希时间轮，由所属loop的timerfd按next_tick单次定时驱动，add/cancel均为O(1)；
+// 节点以下标组成侵入式双向链表，前slot_count个节点为各槽位的哨兵，其后一个为到期链表哨兵；
+// 位图记录非空槽位，推进和查找最早到期时跳过空槽
+class EpollTimerWheel
+{
+public:
+	EpollTimerWheel(uint64_t tick_ms, uint32_t slot_count) {
+		_tick_ms = tick_ms;
+		_slot_count = slot_count;
+		_cur_tick = 0;
+		_size = 0;
+		_free_head = NIL;
+		_next_tick = 0;
+		_bitmap.resize((slot_count + 63) / 64);
+		_nodes.resize(slot_count + 1);
+		for (uint32_t i = 0; i <= slot_count; i++) {
+			_nodes[i].prev = _nodes[i].next = i;
+		}
+	}
+
+	// 首次使用前以当前时间初始化
+	void reset(uint64_t now_ms) {
+		_cur_tick = now_ms / _tick_ms;
+	}
+
+	// interval_ms大于0为周期定时器
+	EpollTimerId add(uint64_t now_ms, uint64_t delay_ms, uint64_t interval_ms, EpollTimerFunc func) {
+		auto index = alloc_node();
+		auto& node = _nodes[index];
+		node.expire_tick = to_tick(now_ms, delay_ms);
+		node.interval_ticks = interval_ms > 0 ? (interval_ms + _tick_ms - 1) / _tick_ms : 0;
+		node.running = false;
+		node.cancelled = false;
+		node.func = std::move(func);
+		link_slot(index);
+		if (_next_tick != 0 && node.expire_tick < _next_tick) {
+			_next_tick = node.expire_tick;
+		}
+		_size++;
+		return ((uint64_t)node.gen << 32) | index;
+	}
+
+	bool cancel(EpollTimerId id) {
+		auto index = (uint32_t)id;
+		if (index <= _slot_count || index >= _nodes.size()) {
+			return false;
+		}
+		auto& node = _nodes[index];
+		if (node.gen != (uint32_t)(id >> 32) || node.cancelled) {
+			return false;
+		}
+		// 正在执行的节点由advance在回调返回后回收
+		node.cancelled = true;
+		if (!node.running) {
+			unlink(index);
+			clear_if_empty(slot_of(node.expire_tick));
+			if (node.expire_tick == _next_tick) {
+				_next_tick = 0;
+			}
+			free_node(index);
+		}
+		return true;
+	}
+
+	// 执行所有到期(expire_tick <= now_tick)的定时器
+	void advance(uint64_t now_ms) {
+		auto target = now_ms / _tick_ms;
+		if (target <= _cur_tick) {
+			return ;
+		}
+		// 跨度超过一圈时每个槽位只需扫描一次
+		auto steps = target - _cur_tick;
+		if (steps > _slot_count) {
+			steps = _slot_count;
+		}
+		for (uint64_t i = 1; i <= steps; i++) {
+			auto distance = find_slot(slot_of(_cur_tick + i));
+			if (distance < 0 || i + distance > steps) {
+				break ;
+			}
+			i += distance;
+			auto head = slot_of(_cur_tick + i);
+			auto index = _nodes[head].next;
+			while (index != head) {
+				auto next = _nodes[index].next;
+				if (_nodes[index].expire_tick <= target) {
+					unlink(index);
+					link(pending(), index);
+				}
+				index = next;
+			}
+			clear_if_empty(head);
+		}
+		_cur_tick = target;
+		_next_tick = 0;
+
+		// 回调中可能增删定时器导致_nodes扩容，执行期间不持有节点引用
+		while (_nodes[pending()].next != pending()) {
+			auto index = _nodes[pending()].next;
+			unlink(index);
+			_nodes[index].running = true;
+			auto func = std::move(_nodes[index].func);
+			func();
+			auto& node = _nodes[index];
+			node.running = false;
+			if (node.interval_ticks > 0 && !node.cancelled) {
+				node.func = std::move(func);
+				// 按上次的到期点累加，不随执行延迟漂移；落后超过一个周期时跳过错过的周期
+				node.expire_tick += node.interval_ticks;
+				if (node.expire_tick <= _cur_tick) {
+					node.expire_tick += (_cur_tick - node.expire_tick) / node.interval_ticks * node.interval_ticks + node.interval_ticks;
+				}
+				link_slot(index);
+			} else {
+				free_node(index);
+			}
+		}
+		_next_tick = 0;
+	}
+
+	// 最早的到期tick，无定时器时返回0；结果缓存到下次advance或取消该定时器。
+	// 按位图从当前tick起查找非空槽，某槽中有恰好在该tick到期的节点即为最小值
+	uint64_t next_tick() {
+		if (_size == 0) {
+			return 0;
+		}
+		if (_next_tick != 0) {
+			return _next_tick;
+		}
+		uint64_t next = 0;
+		for (uint64_t i = 1; i <= _slot_count; i++) {
+			auto distance = find_slot(slot_of(_cur_tick + i));
+			if (distance < 0 || i + distance > _slot_count) {
+				break ;
+			}
+			i += distance;
+			auto tick = _cur_tick + i;
+			if (next != 0 && next <= tick) {
+				break ;
+			}
+			auto head = slot_of(tick);
+			for (auto index = _nodes[head].next; index != head; index = _nodes[index].next) {
+				auto expire_tick = _nodes[index].expire_tick;
+				if (next == 0 || expire_tick < next) {
+					next = expire_tick;
+				}
+			}
+		}
+		_next_tick = next;
+		return next;
+	}
+
+	// id对应定时器的到期tick，id无效时返回0
+	uint64_t expire_tick(EpollTimerId id) {
+		auto index = (uint32_t)id;
+		if (index <= _slot_count || index >= _nodes.size() || _nodes[index].gen != (uint32_t)(id >> 32)) {
+			return 0;
+		}
+		return _nodes[index].expire_tick;
+	}
+
+	size_t size() {return _size;}
+
+	bool empty() {return _size == 0;}
+
+	uint64_t tick_ms() {return _tick_ms;}
+
+private:
+	enum {
+		NIL = 0xffffffff,
+	};
+
+	struct Node
+	{
+		uint32_t	prev;
+		uint32_t	next;
+		uint32_t	gen;
+		bool		running;
+		bool		cancelled;
+		uint64_t	expire_tick;
+		uint64_t	interval_ticks;
+		EpollTimerFunc	func;
+	};
+
+	uint64_t to_tick(uint64_t now_ms, uint64_t delay_ms) {
+		auto ticks = (now_ms + delay_ms + _tick_ms - 1) / _tick_ms;
+		return ticks > _cur_tick ? ticks : _cur_tick + 1;
+	}
+
+	uint32_t slot_of(uint64_t tick) {
+		return (uint32_t)(tick % _slot_count);
+	}
+
+	uint32_t alloc_node() {
+		uint32_t index;
+		if (_free_head != NIL) {
+			index = _free_head;
+			_free_head = _nodes[index].next;
+		} else {
+			index = (uint32_t)_nodes.size();
+			_nodes.emplace_back();
+			_nodes[index].gen = 1;
+		}
+		return index;
+	}
+
+	void free_node(uint32_t index) {
+		auto& node = _nodes[index];
+		node.func = nullptr;
+		node.cancelled = true;
+		// 代数递增使旧id失效，0保留为无效id
+		node.gen = node.gen + 1 ? node.gen + 1 : 1;
+		node.next = _free_head;
+		_free_head = index;
+		_size--;
+	}
+
+	void link(uint32_t head, uint32_t index) {
+		auto& node = _nodes[index];
+		node.prev = head;
+		node.next = _nodes[head].next;
+		_nodes[node.next].prev = index;
+		_nodes[head].next = index;
+	}
+
+	void unlink(uint32_t index) {
+		auto& node = _nodes[index];
+		_nodes[node.prev].next = node.next;
+		_nodes[node.next].prev = node.prev;
+		node.prev = node.next = index;
+	}
+
+	void link_slot(uint32_t index) {
+		auto slot = slot_of(_nodes[index].expire_tick);
+		link(slot, index);
+		_bitmap[slot / 64] |= 1ULL << (slot % 64);
+	}
+
+	void clear_if_empty(uint32_t slot) {
+		if (_nodes[slot].next == slot) {
+			_bitmap[slot / 64] &= ~(1ULL << (slot % 64));
+		}
+	}
+
+	// 从start起循环查找第一个非空槽，返回距离，无则返回-1
+	int64_t find_slot(uint32_t start) {
+		auto words = (uint32_t)_bitmap.size();
+		for (uint32_t i = 0; i <= words; i++) {
+			auto word = (start / 64 + i) % words;
+			auto bits = _bitmap[word];
+			if (i == 0) {
+				bits &= ~0ULL << (start % 64);
+			} else if (i == words) {
+				bits &= (start % 64) ? ~(~0ULL << (start % 64)) : 0;
+			}
+			if (bits) {
+				auto slot = word * 64 + __builtin_ctzll(bits);
+				return ((int64_t)slot - start + _slot_count) % _slot_count;
+			}
+		}
+		return -1;
+	}
+
+	// 紧跟槽位哨兵之后的到期待执行链表
+	uint32_t pending() {return _slot_count;}
+
+private:
+	uint64_t	_tick_ms;
+	uint32_t	_slot_count;
+	uint64_t	_cur_tick;
+	size_t		_size;
+	uint32_t	_free_head;
+	uint64_t	_next_tick;		// next_tick的缓存，0为未知
+
+	vector<Node>	_nodes;
+	vector<uint64_t>	_bitmap;
+};
+
+#endif
@@ -0,0 +1,337 @@
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "epoll_executor.h"
+
+bool EpollEngine::create_urings()
+{
+	bool flag = true;
+	for (auto& item : _epoll_infos) {
+		item->ring = new IoUring;
+		if (!item->ring->init(EPOLL_URING_ENTRIES)) {
+			printf("%s|io_uring_setup fail, error:%s\n", __FUNCTION__, strerror(errno));
+			flag = false;
+			break ;
+		}
+		if (!item->ring->init_buf_ring(0, EPOLL_URING_BUF_COUNT, EPOLL_URING_BUF_SIZE)) {
+			printf("%s|register buf ring fail, error:%s\n", __FUNCTION__, strerror(errno));
+			flag = false;
+			break ;
+		}
+	}
+	if (!flag) {
+		printf("%s|io_uring unavailable, fallback to epoll\n", __FUNCTION__);
+		for (auto& item : _epoll_infos) {
+			delete item->ring;
+			item->ring = NULL;
+		}
+	}
+	return flag;
+}
+
+struct io_uring_sqe* EpollEngine::uring_get_sqe(EpollInfo& info)
+{
+	auto sqe = info.ring->get_sqe();
+	while (!sqe) {
+		// SQ已满，先提交已有请求
+		info.ring->submit_and_wait(0);
+		sqe = info.ring->get_sqe();
+	}
+	return sqe;
+}
+
+void EpollEngine::uring_poll_internal(EpollInfo& info, int fd, uint64_t tag)
+{
+	auto sqe = uring_get_sqe(info);
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = fd;
+	sqe->poll32_events = POLLIN;
+	sqe->len = IORING_POLL_ADD_MULTI;
+	sqe->user_data = tag;
+}
+
+EpollUringSendOp* EpollEngine::uring_alloc_send(EpollInfo& info)
+{
+	if (!info.free_sends) {
+		return new EpollUringSendOp;
+	}
+	auto op = static_cast<EpollUringSendOp*>(info.free_sends);
+	info.free_sends = op->next;
+	info.free_send_count--;
+	return op;
+}
+
+void EpollEngine::uring_free_op(EpollInfo& info, EpollUringOp* op)
+{
+	if (op->kind != URING_OP_SEND) {
+		delete op;
+		return ;
+	}
+	// 回收前释放channel引用，最后一个引用可能在此析构
+	op->chan.reset();
+	if (info.free_send_count >= URING_SEND_CACHE) {
+		delete static_cast<EpollUringSendOp*>(op);
+		return ;
+	}
+	op->next = info.free_sends;
+	info.free_sends = op;
+	info.free_send_count++;
+}
+
+void EpollEngine::uring_submit(EpollInfo& info, shared_ptr<EpollChannel> chan, int kind)
+{
+	EpollUringOp* op = NULL;
+	int iov_count = 0;
+	if (kind == URING_OP_SEND) {
+		auto send = uring_alloc_send(info);
+		iov_count = static_cast<EpollChannelConnect*>(chan.get())->prepare_send(send->iov, URING_SEND_IOV);
+		if (iov_count == 0) {
+			send->kind = URING_OP_SEND;
+			uring_free_op(info, send);
+			kind = URING_OP_POLL_OUT;
+		} else {
+			memset(&send->msg, 0, sizeof(send->msg));
+			send->msg.msg_iov = send->iov;
+			send->msg.msg_iovlen = iov_count;
+			op = send;
+		}
+	}
+	if (!op) {
+		op = new EpollUringOp;
+	}
+
+	op->chan = chan;
+	op->gen = chan->_gen.load(memory_order_acquire);
+	op->kind = kind;
+	op->prev = &info.ops;
+	op->next = info.ops.next;
+	info.ops.next->prev = op;
+	info.ops.next = op;
+
+	auto sqe = uring_get_sqe(info);
+	sqe->fd = chan->get_fd();
+	sqe->user_data = (uint64_t)(uintptr_t)op;
+	switch (kind) {
+	case URING_OP_RECV:
+		sqe->opcode = IORING_OP_RECV;
+		sqe->ioprio = IORING_RECV_MULTISHOT;
+		sqe->flags = IOSQE_BUFFER_SELECT;
+		sqe->buf_group = info.ring->buf_group();
+		chan->_uring_flags |= URING_RECV_ARMED;
+		break ;
+	case URING_OP_POLL_IN:
+		sqe->opcode = IORING_OP_POLL_ADD;
+		sqe->poll32_events = POLLIN;
+		sqe->len = IORING_POLL_ADD_MULTI;
+		chan->_uring_flags |= URING_RECV_ARMED;
+		break ;
+	case URING_OP_POLL_OUT:
+		sqe->opcode = IORING_OP_POLL_ADD;
+		sqe->poll32_events = POLLOUT;
+		chan->_uring_flags |= URING_SEND_ARMED;
+		break ;
+	case URING_OP_ACCEPT:
+		sqe->opcode = IORING_OP_ACCEPT;
+		sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+		sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+		chan->_uring_flags |= URING_RECV_ARMED;
+		break ;
+	case URING_OP_SEND:
+		sqe->opcode = IORING_OP_SENDMSG;
+		sqe->addr = (uint64_t)(uintptr_t)&static_cast<EpollUringSendOp*>(op)->msg;
+		sqe->len = 1;
+		sqe->msg_flags = MSG_NOSIGNAL;
+		chan->_uring_flags |= URING_SEND_ARMED;
+		break ;
+	}
+}
+
+void EpollEngine::uring_cancel(EpollInfo& info, shared_ptr<EpollChannel> chan)
+{
+	auto sqe = uring_get_sqe(info);
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->fd = chan->get_fd();
+	sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+	sqe->user_data = EPOLL_TAG_CANCEL;
+}
+
+void EpollEngine::uring_arm_async(int index, shared_ptr<EpollChannel> chan)
+{
+	if (get_current_loop() == index) {
+		_epoll_infos[index]->arm_pending.push_back(chan);
+		return ;
+	}
+	post(index, [this, index, chan] {
+		uring_arm(*_epoll_infos[index], chan);
+	});
+}
+
+void EpollEngine::uring_arm(EpollInfo& info, shared_ptr<EpollChannel> chan)
+{
+	int events;
+	{
+		auto fd_info = _fd_table->get(chan->get_fd());
+		lock_guard<mutex> lock(info.lock);
+		if (!fd_info || fd_info->chan.load(memory_order_relaxed) != chan.get()) {
+			return ;
+		}
+		events = fd_info->events;
+	}
+	if ((events & EPOLL_RECV) && !(chan->_uring_flags & URING_RECV_ARMED)) {
+		// 设置了factory的监听socket由内核直接accept，连接socket直接收数据到buffer ring
+		auto server = dynamic_pointer_cast<EpollChannelServer>(chan);
+		auto listener = dynamic_pointer_cast<EpollChannelListener>(chan);
+		if (listener) {
+			server = listener->get_server();
+		}
+		if (server && server->has_factory() && !(chan->_uring_flags & URING_POLL_ACCEPT)) {
+			uring_submit(info, chan, URING_OP_ACCEPT);
+		} else if (dynamic_cast<EpollChannelConnect*>(chan.get()) && !(chan->_uring_flags & URING_POLL_RECV)) {
+			uring_submit(info, chan, URING_OP_RECV);
+		} else {
+			uring_submit(info, chan, URING_OP_POLL_IN);
+		}
+	}
+	// 连接直接提交sendmsg，各连接的发送与其他请求合并在同一次io_uring_enter中，
+	// socket不可写时由内核内部等待，无需先poll再writev
+	if ((events & EPOLL_SEND) && !(chan->_uring_flags & URING_SEND_ARMED)) {
+		if (dynamic_cast<EpollChannelConnect*>(chan.get())) {
+			uring_submit(info, chan, URING_OP_SEND);
+		} else {
+			uring_submit(info, chan, URING_OP_POLL_OUT);
+		}
+	}
+}
+
+void EpollEngine::uring_complete(EpollInfo& info, int index, const struct io_uring_cqe& cqe)
+{
+	bool more = cqe.flags & IORING_CQE_F_MORE;
+	if (cqe.user_data == EPOLL_TAG_WAKEUP || cqe.user_data == EPOLL_TAG_TIMER) {
+		if (cqe.user_data == EPOLL_TAG_WAKEUP) {
+			run_tasks(info);
+		} else {
+			run_timers(info);
+		}
+		if (!more) {
+			uring_poll_internal(info, cqe.user_data == EPOLL_TAG_WAKEUP ? info.event_fd : info.timer_fd, cqe.user_data);
+		}
+		return ;
+	}
+	if (cqe.user_data == EPOLL_TAG_CANCEL) {
+		return ;
+	}
+
+	auto op = (EpollUringOp*)(uintptr_t)cqe.user_data;
+	auto chan = op->chan;
+	auto kind = op->kind;
+	// 已del或重新注册的channel的完成事件只做资源回收
+	bool valid = chan->_gen.load(memory_order_acquire) == op->gen && !chan->is_released();
+
+	if (!more) {
+		chan->_uring_flags &= (kind == URING_OP_POLL_OUT || kind == URING_OP_SEND) ? ~URING_SEND_ARMED : ~URING_RECV_ARMED;
+		op->prev->next = op->next;
+		op->next->prev = op->prev;
+		uring_free_op(info, op);
+	}
+
+	switch (kind) {
+	case URING_OP_RECV:
+		if (cqe.flags & IORING_CQE_F_BUFFER) {
+			auto bid = (uint16_t)(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+			if (valid && cqe.res > 0) {
+				static_cast<EpollChannelConnect*>(chan.get())->on_recv(info.ring->get_buf(bid), cqe.res);
+			}
+			info.ring->add_buf(bid);
+			info.ring->commit_bufs();
+		} else if (valid && cqe.res == -EINVAL) {
+			printf("[%d] %s|multishot recv unsupported, fd:%d, use poll\n", gettid(), __FUNCTION__, chan->get_fd());
+			chan->_uring_flags |= URING_POLL_RECV;
+		} else if (valid && cqe.res == 0) {
+			static_cast<EpollChannelConnect*>(chan.get())->on_recv_fail(0);
+		} else if (valid && cqe.res < 0 && cqe.res != -ENOBUFS && cqe.res != -ECANCELED) {
+			static_cast<EpollChannelConnect*>(chan.get())->on_recv_fail(-cqe.res);
+		}
+		break ;
+	case URING_OP_POLL_IN:
+		if (valid && cqe.res >= 0) {
+			chan->on_recv();
+		}
+		break ;
+	case URING_OP_POLL_OUT:
+		if (valid && cqe.res >= 0) {
+			chan->on_send();
+		}
+		break ;
+	case URING_OP_SEND:
+		// 在途期间channel被del时也要解除发送队列的锁定
+		static_cast<EpollChannelConnect*>(chan.get())->on_send_complete(cqe.res, valid);
+		break ;
+	case URING_OP_ACCEPT:
+		if (cqe.res >= 0) {
+			auto listener = dynamic_pointer_cast<EpollChannelListener>(chan);
+			auto server = listener ? listener->get_server() : static_pointer_cast<EpollChannelServer>(chan);
+			if (valid && server) {
+				server->accept_fd(cqe.res, index);
+			} else {
+				close(cqe.res);
+			}
+		} else if (cqe.res == -EMFILE || cqe.res == -ENFILE) {
+			// fd耗尽时多路accept重新提交会立即再次失败，先拒绝一个连接
+			auto listener = dynamic_pointer_cast<EpollChannelListener>(chan);
+			auto server = listener ? listener->get_server() : static_pointer_cast<EpollChannelServer>(chan);
+			if (valid && server) {
+				server->drop_one(chan->get_fd());
+			}
+		} else if (cqe.res != -ECANCELED && cqe.res != -EAGAIN && cqe.res != -EINTR && cqe.res != -ECONNABORTED) {
+			// 其他错误重新提交会空转，改为poll后走accept_batch
+			printf("[%d] %s|accept fail, fd:%d, error:%s, fallback to poll\n", gettid(), __FUNCTION__, chan->get_fd(), strerror(-cqe.res));
+			chan->_uring_flags |= URING_POLL_ACCEPT;
+		}
+		break ;
+	}
+
+	if (!valid) {
+		return ;
+	}
+	if (chan->is_released()) {
+		remove(chan.get());
+	} else if (!more) {
+		// 多路请求被内核终止(如buffer耗尽)或单次poll完成后按当前关注事件重新提交
+		uring_arm(info, chan);
+	}
+}
+
+void EpollEngine::run_uring(int index)
+{
+	bool running = true;
+	EpollInfo& info = *_epoll_infos[index];
+	t_engine = this;
+	t_loop_index = index;
+
+	uring_poll_internal(info, info.event_fd, EPOLL_TAG_WAKEUP);
+	uring_poll_internal(info, info.timer_fd, EPOLL_TAG_TIMER);
+
+	while (running) {
+		release_retired(info);
+		for (size_t i = 0; i < info.arm_pending.size(); i++) {
+			uring_arm(info, info.arm_pending[i]);
+		}
+		info.arm_pending.clear();
+		// 本轮产生的所有SQE与等待合并为一次io_uring_enter
+		auto ret = info.ring->submit_and_wait(1);
+		if (ret == -1 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+			printf("[%d] %s|io_uring_enter fail, error:%s\n", gettid(), __FUNCTION__, strerror(errno));
+		}
+		auto head = info.ring->cq_head();
+		auto tail = info.ring->cq_tail();
+		for (; head != tail; head++) {
+			auto cqe = *info.ring->cqe_at(head);
+			info.ring->cq_advance(head + 1);
+			uring_complete(info, index, cqe);
+		}
+		if (_stop) {
+			drain_tasks(info);
+			running = false;
+		}
+	}
+}
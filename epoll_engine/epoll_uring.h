@@ -0,0 +1,215 @@
+#ifndef __EPOLL_URING_H__
+#define __EPOLL_URING_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+// 不依赖liburing的最小io_uring封装，仅供EpollEngine的io_uring后端使用：
+// 单个loop线程独占提交与收割，附带一个provided buffer ring供多路recv选择缓冲区
+class IoUring
+{
+public:
+	IoUring() {
+		_fd = -1;
+		_ring_ptr = NULL;
+		_ring_size = 0;
+		_sqes = NULL;
+		_sqe_tail = _sqe_head = 0;
+		_buf_ring = NULL;
+		_buf_base = NULL;
+		_buf_count = _buf_size = 0;
+		_buf_tail = 0;
+	}
+
+	~IoUring() {
+		free(_buf_ring);
+		free(_buf_base);
+		if (_sqes) {
+			munmap(_sqes, _sq_entries * sizeof(struct io_uring_sqe));
+		}
+		if (_ring_ptr) {
+			munmap(_ring_ptr, _ring_size);
+		}
+		if (_fd != -1) {
+			close(_fd);
+		}
+	}
+
+	// 内核不支持(ENOSYS/EPERM等)时返回false，由调用方回退epoll
+	bool init(unsigned entries) {
+		struct io_uring_params p;
+		memset(&p, 0, sizeof(p));
+		p.flags = IORING_SETUP_COOP_TASKRUN;
+		_fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+		if (_fd == -1 && errno == EINVAL) {
+			memset(&p, 0, sizeof(p));
+			_fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+		}
+		if (_fd == -1) {
+			return false;
+		}
+		if (!(p.features & IORING_FEAT_SINGLE_MMAP) || !(p.features & IORING_FEAT_NODROP)) {
+			errno = ENOTSUP;
+			return false;
+		}
+
+		// SINGLE_MMAP下SQ与CQ共用一次映射
+		size_t sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+		size_t cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+		_ring_size = sq_size > cq_size ? sq_size : cq_size;
+		_ring_ptr = (char*)mmap(NULL, _ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+		if (_ring_ptr == MAP_FAILED) {
+			_ring_ptr = NULL;
+			return false;
+		}
+
+		_sqes = (struct io_uring_sqe*)mmap(
+			NULL,
+			p.sq_entries * sizeof(struct io_uring_sqe),
+			PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE,
+			_fd,
+			IORING_OFF_SQES
+		);
+		if (_sqes == MAP_FAILED) {
+			_sqes = NULL;
+			return false;
+		}
+
+		_sq_khead = (unsigned*)(_ring_ptr + p.sq_off.head);
+		_sq_ktail = (unsigned*)(_ring_ptr + p.sq_off.tail);
+		_sq_mask = *(unsigned*)(_ring_ptr + p.sq_off.ring_mask);
+		_sq_entries = p.sq_entries;
+		_sq_array = (unsigned*)(_ring_ptr + p.sq_off.array);
+
+		_cq_khead = (unsigned*)(_ring_ptr + p.cq_off.head);
+		_cq_ktail = (unsigned*)(_ring_ptr + p.cq_off.tail);
+		_cq_mask = *(unsigned*)(_ring_ptr + p.cq_off.ring_mask);
+		_cqes = (struct io_uring_cqe*)(_ring_ptr + p.cq_off.cqes);
+
+		_sqe_tail = _sqe_head = *_sq_ktail;
+		return true;
+	}
+
+	// count需为2的幂，内核不支持buffer ring(<5.19)时返回false
+	bool init_buf_ring(uint16_t bgid, unsigned count, unsigned size) {
+		// ring地址需按页对齐
+		void* ring = NULL;
+		if (posix_memalign(&ring, 4096, count * sizeof(struct io_uring_buf)) != 0) {
+			return false;
+		}
+		memset(ring, 0, count * sizeof(struct io_uring_buf));
+		_buf_ring = (struct io_uring_buf_ring*)ring;
+		_buf_count = count;
+		_buf_size = size;
+		_buf_base = (char*)malloc((size_t)count * size);
+		if (!_buf_base) {
+			return false;
+		}
+
+		struct io_uring_buf_reg reg;
+		memset(&reg, 0, sizeof(reg));
+		reg.ring_addr = (uint64_t)(uintptr_t)_buf_ring;
+		reg.ring_entries = count;
+		reg.bgid = bgid;
+		if (syscall(__NR_io_uring_register, _fd, IORING_REGISTER_PBUF_RING, &reg, 1) == -1) {
+			return false;
+		}
+		_bgid = bgid;
+		for (unsigned i = 0; i < count; i++) {
+			add_buf((uint16_t)i);
+		}
+		commit_bufs();
+		return true;
+	}
+
+	// SQ已满时返回NULL，调用方需先submit
+	struct io_uring_sqe* get_sqe() {
+		auto head = __atomic_load_n(_sq_khead, __ATOMIC_ACQUIRE);
+		if (_sqe_tail - head >= _sq_entries) {
+			return NULL;
+		}
+		auto index = _sqe_tail & _sq_mask;
+		auto sqe = &_sqes[index];
+		memset(sqe, 0, sizeof(*sqe));
+		_sq_array[index] = index;
+		_sqe_tail++;
+		return sqe;
+	}
+
+	// 提交所有新SQE并等待至少wait_nr个完成事件，一次系统调用完成
+	int submit_and_wait(unsigned wait_nr) {
+		__atomic_store_n(_sq_ktail, _sqe_tail, __ATOMIC_RELEASE);
+		auto to_submit = _sqe_tail - _sqe_head;
+		unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+		auto ret = (int)syscall(__NR_io_uring_enter, _fd, to_submit, wait_nr, flags, NULL, 0);
+		if (ret >= 0) {
+			_sqe_head += ret;
+		}
+		return ret;
+	}
+
+	unsigned cq_head() {return *_cq_khead;}
+
+	unsigned cq_tail() {return __atomic_load_n(_cq_ktail, __ATOMIC_ACQUIRE);}
+
+	struct io_uring_cqe* cqe_at(unsigned pos) {return &_cqes[pos & _cq_mask];}
+
+	void cq_advance(unsigned head) {__atomic_store_n(_cq_khead, head, __ATOMIC_RELEASE);}
+
+	char* get_buf(uint16_t bid) {return _buf_base + (size_t)bid * _buf_size;}
+
+	unsigned buf_size() {return _buf_size;}
+
+	uint16_t buf_group() {return _bgid;}
+
+	// 归还内核选中的缓冲区，commit_bufs后对内核可见
+	// C++下内核头文件的__DECLARE_FLEX_ARRAY会使bufs偏移8字节，这里按数组直接寻址
+	void add_buf(uint16_t bid) {
+		auto buf = &((struct io_uring_buf*)_buf_ring)[_buf_tail & (_buf_count - 1)];
+		buf->addr = (uint64_t)(uintptr_t)get_buf(bid);
+		buf->len = _buf_size;
+		buf->bid = bid;
+		_buf_tail++;
+	}
+
+	void commit_bufs() {
+		__atomic_store_n(&_buf_ring->tail, _buf_tail, __ATOMIC_RELEASE);
+	}
+
+private:
+	int		_fd;
+
+	char*	_ring_ptr;
+	size_t	_ring_size;
+
+	unsigned*	_sq_khead;
+	unsigned*	_sq_ktail;
+	unsigned*	_sq_array;
+	unsigned	_sq_mask;
+	unsigned	_sq_entries;
+	unsigned	_sqe_tail;
+	unsigned	_sqe_head;
+	struct io_uring_sqe*	_sqes;
+
+	unsigned*	_cq_khead;
+	unsigned*	_cq_ktail;
+	unsigned	_cq_mask;
+	struct io_uring_cqe*	_cqes;
+
+	struct io_uring_buf_ring*	_buf_ring;
+	char*		_buf_base;
+	unsigned	_buf_count;
+	unsigned	_buf_size;
+	uint16_t	_buf_tail;
+	uint16_t	_bgid;
+};
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef __FUTEX_WAITER_H__
+#define __FUTEX_WAITER_H__
+
+#include <time.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#include <atomic>
+
+using namespace std;
+
+// 基于futex的条件等待：等待方先登记再复查条件，通知方只在有等待者时才递增序号并进入内核，
+// 无人等待时通知只有一次fence和一次读
+class FutexWaiter
+{
+public:
+    FutexWaiter() {
+        _seq = 0;
+        _waiters = 0;
+    }
+
+    // 等待ready()为真，timeout_ms < 0表示一直等待，超时返回false
+    template <class Pred>
+    bool wait(Pred ready, int timeout_ms = -1) {
+        if (ready()) {
+            return true;
+        }
+        if (timeout_ms < 0) {
+            return wait_impl(ready, NULL);
+        }
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        return wait_impl(ready, &deadline);
+    }
+
+    // 等待到CLOCK_MONOTONIC绝对时间deadline，精度由内核hrtimer决定，不受毫秒取整限制
+    template <class Pred>
+    bool wait_until(Pred ready, const struct timespec& deadline) {
+        if (ready()) {
+            return true;
+        }
+        return wait_impl(ready, &deadline);
+    }
+
+    // 条件变化后调用，须在发布条件的release写之后
+    void notify(bool all = false) {
+        atomic_thread_fence(memory_order_seq_cst);
+        if (_waiters.load(memory_order_relaxed) == 0) {
+            return ;
+        }
+        _seq.fetch_add(1, memory_order_seq_cst);
+        syscall(SYS_futex, &_seq, FUTEX_WAKE_PRIVATE, all ? INT_MAX : 1, NULL, NULL, 0);
+    }
+
+private:
+    // FUTEX_WAIT_BITSET的超时为绝对时间，被提前唤醒后重试无需重新计算剩余时间
+    template <class Pred>
+    bool wait_impl(Pred ready, const struct timespec* deadline) {
+        while (1) {
+            _waiters.fetch_add(1, memory_order_seq_cst);
+            atomic_thread_fence(memory_order_seq_cst);
+            auto seq = _seq.load(memory_order_seq_cst);
+            if (ready()) {
+                _waiters.fetch_sub(1, memory_order_relaxed);
+                return true;
+            }
+            if (deadline && expired(*deadline)) {
+                _waiters.fetch_sub(1, memory_order_relaxed);
+                return false;
+            }
+            syscall(SYS_futex, &_seq, FUTEX_WAIT_BITSET_PRIVATE, seq, deadline, NULL, FUTEX_BITSET_MATCH_ANY);
+            _waiters.fetch_sub(1, memory_order_relaxed);
+            if (ready()) {
+                return true;
+            }
+        }
+    }
+
+    static bool expired(const struct timespec& deadline) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return now.tv_sec > deadline.tv_sec || (now.tv_sec == deadline.tv_sec && now.tv_nsec >= deadline.tv_nsec);
+    }
+
+private:
+    atomic<uint32_t>    _seq;
+    atomic<uint32_t>    _waiters;
+};
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef __INLINE_FUNCTION_H__
+#define __INLINE_FUNCTION_H__
+
+#include <stddef.h>
+
+#include <new>
+#include <utility>
+#include <type_traits>
+
+using namespace std;
+
+template <class Sig, size_t N = 48>
+class InlineFunction;
+
+// 只可移动的std::function替代，不超过N字节的可调用对象直接存放在对象内部，构造与移动均不分配内存；
+// 超出N字节或不能无异常移动的退回堆分配
+template <class R, class... Args, size_t N>
+class InlineFunction<R(Args...), N>
+{
+public:
+    InlineFunction() {
+        _ops = NULL;
+    }
+
+    InlineFunction(nullptr_t) : InlineFunction() {}
+
+    template <class F, class = typename enable_if<!is_same<typename decay<F>::type, InlineFunction>::value>::type>
+    InlineFunction(F&& func) : InlineFunction() {
+        assign(std::forward<F>(func));
+    }
+
+    InlineFunction(InlineFunction&& other) : InlineFunction() {
+        move_from(other);
+    }
+
+    ~InlineFunction() {
+        reset();
+    }
+
+    InlineFunction(const InlineFunction&) = delete;
+    InlineFunction& operator=(const InlineFunction&) = delete;
+
+    InlineFunction& operator=(InlineFunction&& other) {
+        if (this != &other) {
+            reset();
+            move_from(other);
+        }
+        return *this;
+    }
+
+    InlineFunction& operator=(nullptr_t) {
+        reset();
+        return *this;
+    }
+
+    template <class F, class = typename enable_if<!is_same<typename decay<F>::type, InlineFunction>::value>::type>
+    InlineFunction& operator=(F&& func) {
+        reset();
+        assign(std::forward<F>(func));
+        return *this;
+    }
+
+    R operator()(Args... args) {
+        return _ops->invoke(_storage, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const {
+        return _ops != NULL;
+    }
+
+    void reset() {
+        if (_ops) {
+            _ops->destroy(_storage);
+            _ops = NULL;
+        }
+    }
+
+private:
+    struct Ops
+    {
+        R       (*invoke)(void* storage, Args&&... args);
+        void    (*move)(void* dst, void* src);
+        void    (*destroy)(void* storage);
+    };
+
+    template <class F>
+    struct InlineOps
+    {
+        static R invoke(void* storage, Args&&... args) {
+            return (*(F*)storage)(std::forward<Args>(args)...);
+        }
+
+        static void move(void* dst, void* src) {
+            new (dst) F(std::move(*(F*)src));
+            ((F*)src)->~F();
+        }
+
+        static void destroy(void* storage) {
+            ((F*)storage)->~F();
+        }
+
+        static constexpr Ops ops = {invoke, move, destroy};
+    };
+
+    template <class F>
+    struct HeapOps
+    {
+        static R invoke(void* storage, Args&&... args) {
+            return (**(F**)storage)(std::forward<Args>(args)...);
+        }
+
+        static void move(void* dst, void* src) {
+            *(F**)dst = *(F**)src;
+        }
+
+        static void destroy(void* storage) {
+            delete *(F**)storage;
+        }
+
+        static constexpr Ops ops = {invoke, move, destroy};
+    };
+
+    template <class F>
+    void assign(F&& func) {
+        typedef typename decay<F>::type T;
+        if (is_null(func)) {
+            return ;
+        }
+        if constexpr (sizeof(T) <= N && alignof(T) <= alignof(max_align_t) && is_nothrow_move_constructible<T>::value) {
+            new (_storage) T(std::forward<F>(func));
+            _ops = &InlineOps<T>::ops;
+        } else {
+            *(T**)_storage = new T(std::forward<F>(func));
+            _ops = &HeapOps<T>::ops;
+        }
+    }
+
+    void move_from(InlineFunction& other) {
+        if (other._ops) {
+            other._ops->move(_storage, other._storage);
+            _ops = other._ops;
+            other._ops = NULL;
+        }
+    }
+
+    // 空的函数指针或std::function视为未设置
+    template <class F>
+    static bool is_null(const F& func) {
+        if constexpr (is_pointer<F>::value || is_constructible<bool, const F&>::value) {
+            return !func;
+        }
+        return false;
+    }
+
+private:
+    alignas(max_align_t) char   _storage[N < sizeof(void*) ? sizeof(void*) : N];
+    const Ops*  _ops;
+};
+
+#endif
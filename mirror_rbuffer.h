@@ -0,0 +1,195 @@
+#ifndef __MIRROR_RING_BUFFER_H__
+#define __MIRROR_RING_BUFFER_H__
+
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <stdexcept>
+
+using namespace std;
+
+// RBuffer的镜像映射版本：同一memfd在虚拟地址上连续映射两次，
+// 环上任意可读/可写区域都是连续内存，可直接交给分帧器或send/recv，无需拆成两段拷贝
+class MirrorRBuffer
+{
+public:
+    // size按页对齐向上取整
+    MirrorRBuffer(size_t def_size = 0) {
+        _r_pos = 0;
+        _w_pos = 0;
+        _used_size = 0;
+        _size = 0;
+        _base = NULL;
+        _fd = memfd_create("mirror_rbuffer", MFD_CLOEXEC);
+        if (_fd == -1) {
+            throw runtime_error("memfd_create fail");
+        }
+        auto size = page_align(def_size > 0 ? def_size : 1);
+        if (ftruncate(_fd, size) == -1) {
+            close(_fd);
+            throw runtime_error("ftruncate fail");
+        }
+        _base = map(size);
+        if (!_base) {
+            close(_fd);
+            throw runtime_error("mmap fail");
+        }
+        _size = size;
+    }
+
+    ~MirrorRBuffer() {
+        if (_base) {
+            munmap(_base, _size * 2);
+            _base = NULL;
+        }
+        if (_fd != -1) {
+            close(_fd);
+            _fd = -1;
+        }
+        _r_pos = 0;
+        _w_pos = 0;
+        _used_size = 0;
+        _size = 0;
+    }
+
+    MirrorRBuffer(const MirrorRBuffer&) = delete;
+    MirrorRBuffer& operator=(const MirrorRBuffer&) = delete;
+
+    void set(const char* data, size_t size) {
+        reserve(size);
+        memcpy(write_ptr(), data, size);
+        commit_write(size);
+    }
+
+    size_t get(char* data, size_t size) {
+        auto get_size = pick(data, size);
+        commit_read(get_size);
+        return get_size;
+    }
+
+    size_t pick(char* data, size_t size) {
+        size_t get_size = used_size() > size ? size : used_size();
+        if (get_size > 0) {
+            memcpy(data, read_ptr(), get_size);
+        }
+        return get_size;
+    }
+
+    size_t skip(size_t size) {
+        size_t skip_size = used_size() > size ? size : used_size();
+        commit_read(skip_size);
+        return skip_size;
+    }
+
+    // 全部可读数据，长度为used_size()
+    const char* read_ptr() {
+        return _base + _r_pos;
+    }
+
+    void commit_read(size_t size) {
+        _r_pos = (_r_pos + size) % _size;
+        _used_size -= size;
+        // 读空后回到起点，减少跨越镜像边界的访问
+        if (_used_size == 0) {
+            _r_pos = 0;
+            _w_pos = 0;
+        }
+    }
+
+    // 全部可写空间，长度为left_size()
+    char* write_ptr() {
+        return _base + _w_pos;
+    }
+
+    void commit_write(size_t size) {
+        _w_pos = (_w_pos + size) % _size;
+        _used_size += size;
+    }
+
+    // 保证至少size字节可写
+    void reserve(size_t size) {
+        if (left_size() < size) {
+            grow(_used_size + size);
+        }
+    }
+
+	bool empty() {
+		return _used_size == 0;
+	}
+
+    size_t size() {
+        return _size;
+    }
+
+    size_t used_size() {
+		return _used_size;
+    }
+
+    size_t left_size() {
+        return size() - used_size();
+    }
+
+private:
+    static size_t page_align(size_t size) {
+        auto page = (size_t)sysconf(_SC_PAGESIZE);
+        return (size + page - 1) / page * page;
+    }
+
+    // 预留2倍地址空间后将memfd的[0, size)映射到前后两半
+    char* map(size_t size) {
+        auto base = (char*)mmap(NULL, size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            return NULL;
+        }
+        for (int i = 0; i < 2; i++) {
+            auto ptr = mmap(base + size * i, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, _fd, 0);
+            if (ptr == MAP_FAILED) {
+                munmap(base, size * 2);
+                return NULL;
+            }
+        }
+        return base;
+    }
+
+    // 扩大memfd并重新映射，已有数据留在原文件页中不拷贝；
+    // 只有跨越环尾的数据需要搬到新位置，取较短的一段搬移
+    void grow(size_t need_size) {
+        auto new_size = _size;
+        while (new_size < need_size) {
+            new_size *= 2;
+        }
+        new_size = page_align(new_size);
+        if (ftruncate(_fd, new_size) == -1) {
+            throw runtime_error("ftruncate fail");
+        }
+        auto new_base = map(new_size);
+        if (!new_base) {
+            throw runtime_error("mmap fail");
+        }
+        if (_used_size > 0 && _r_pos + _used_size > _size) {
+            auto tail = _size - _r_pos;                 // 环尾[_r_pos, _size)
+            auto head = _r_pos + _used_size - _size;    // 回绕到[0, head)
+            if (head <= tail) {
+                memcpy(new_base + _size, new_base, head);
+            } else {
+                memcpy(new_base + new_size - tail, new_base + _r_pos, tail);
+                _r_pos = new_size - tail;
+            }
+        }
+        munmap(_base, _size * 2);
+        _base = new_base;
+        _size = new_size;
+        _w_pos = (_r_pos + _used_size) % _size;
+    }
+
+private:
+    int     _fd;
+	size_t	_used_size;
+    size_t  _size;
+    size_t  _r_pos;
+    size_t  _w_pos;
+    char*   _base;
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef __MPSC_QUEUE_H__
+#define __MPSC_QUEUE_H__
+
+#include <stddef.h>
+
+#include <atomic>
+#include <utility>
+
+using namespace std;
+
+// 无锁多生产者单消费者队列(Vyukov)，push可在任意线程调用，pop仅限单个消费线程
+template <class T>
+class MpscQueue
+{
+public:
+    MpscQueue() {
+        auto stub = new Node;
+        stub->next.store(NULL, memory_order_relaxed);
+        _head.store(stub, memory_order_relaxed);
+        _tail = stub;
+    }
+
+    ~MpscQueue() {
+        T value;
+        while (pop(value)) {
+            ;
+        }
+        delete _tail;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void push(T value) {
+        auto node = new Node;
+        node->value = std::move(value);
+        node->next.store(NULL, memory_order_relaxed);
+        auto prev = _head.exchange(node, memory_order_acq_rel);
+        prev->next.store(node, memory_order_release);
+    }
+
+    // 生产者已交换_head但尚未链接时也返回false，调用方需依赖生产者的后续通知
+    bool pop(T& value) {
+        auto tail = _tail;
+        auto next = tail->next.load(memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+        value = std::move(next->value);
+        next->value = T();
+        _tail = next;
+        delete tail;
+        return true;
+    }
+
+    bool empty() {
+        return _tail->next.load(memory_order_acquire) == NULL;
+    }
+
+private:
+    struct Node
+    {
+        atomic<Node*>   next;
+        T               value;
+    };
+
+    atomic<Node*>   _head;
+    Node*           _tail;
+};
+
+#endif
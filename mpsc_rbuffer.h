@@ -0,0 +1,213 @@
+#ifndef __MPSC_RING_BUFFER_H__
+#define __MPSC_RING_BUFFER_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <stdexcept>
+
+#include "spsc_rbuffer.h"
+
+using namespace std;
+
+// 多生产者单消费者的定长字节环。每次set以CAS预留一段记录空间，拷贝完成后写入8字节记录头发布，
+// 生产者之间互不等待，一次set的数据不会与其他生产者交错；消费者按记录顺序读取，遇到未发布的记录即停止。
+// 消费者读完的记录清零后才归还，生产者据此以记录头为0判断未发布
+class MpscRBuffer
+{
+public:
+    // 容量向上取整为2的幂，每次set额外占用8字节记录头并按8字节对齐
+    MpscRBuffer(size_t def_size = 1024 * 64) {
+        _size = RECORD_ALIGN * 8;
+        while (_size < def_size) {
+            _size <<= 1;
+        }
+        _mask = _size - 1;
+        _buffer = (char*)calloc(1, _size);
+        if (!_buffer) {
+            throw runtime_error("calloc fail");
+        }
+        _head = 0;
+        _reserve = 0;
+        _r_pos = 0;
+        _r_off = 0;
+    }
+
+    ~MpscRBuffer() {
+        free(_buffer);
+        _buffer = NULL;
+    }
+
+    MpscRBuffer(const MpscRBuffer&) = delete;
+    MpscRBuffer& operator=(const MpscRBuffer&) = delete;
+
+    // 任意线程调用，空间不足时不写入并返回false
+    bool set(const char* data, size_t size) {
+        if (size == 0) {
+            return true;
+        }
+        auto need = record_size(size);
+        if (need > _size) {
+            return false;
+        }
+        auto pos = _reserve.load(memory_order_relaxed);
+        do {
+            if (pos + need - _head.load(memory_order_acquire) > _size) {
+                return false;
+            }
+        } while (!_reserve.compare_exchange_weak(pos, pos + need, memory_order_relaxed));
+
+        copy_in(pos + RECORD_ALIGN, data, size);
+        __atomic_store_n(header(pos), (uint64_t)size, __ATOMIC_RELEASE);
+        _readable.notify();
+        return true;
+    }
+
+    // 以下仅限消费者线程调用
+    size_t get(char* data, size_t size, bool commit = true) {
+        auto get_size = read(data, size, true);
+        if (commit) {
+            commit_get();
+        }
+        return get_size;
+    }
+
+    size_t pick(char* data, size_t size) {
+        return read(data, size, false);
+    }
+
+    size_t skip(size_t size, bool commit = true) {
+        auto skip_size = read(NULL, size, true);
+        if (commit) {
+            commit_get();
+        }
+        return skip_size;
+    }
+
+    // 归还已读完的记录空间
+    void commit_get() {
+        if (_head.load(memory_order_relaxed) == _r_pos) {
+            return ;
+        }
+        _head.store(_r_pos, memory_order_release);
+        _writable.notify(true);
+    }
+
+    // 等待至少一条记录发布
+    bool wait_readable(int timeout_ms = -1) {
+        return _readable.wait([&] {return __atomic_load_n(header(_r_pos), __ATOMIC_ACQUIRE) != 0;}, timeout_ms);
+    }
+
+    // 生产者等待可写入size字节的空间，返回后仍可能被其他生产者抢先
+    bool wait_writable(size_t size, int timeout_ms = -1) {
+        auto need = record_size(size);
+        return _writable.wait([&] {
+            return _reserve.load(memory_order_relaxed) + need - _head.load(memory_order_acquire) <= _size;
+        }, timeout_ms);
+    }
+
+    // 以下按预留空间统计，含记录头及尚未发布的记录
+	bool empty() {
+		return used_size() == 0;
+	}
+
+    size_t size() {
+        return _size;
+    }
+
+    size_t used_size() {
+        return _reserve.load(memory_order_acquire) - _head.load(memory_order_acquire);
+    }
+
+    size_t left_size() {
+        return size() - used_size();
+    }
+
+private:
+    enum {
+        RECORD_ALIGN = 8,
+    };
+
+    static size_t record_size(size_t size) {
+        return RECORD_ALIGN + ((size + RECORD_ALIGN - 1) & ~(size_t)(RECORD_ALIGN - 1));
+    }
+
+    // 记录起点8字节对齐且容量为8的倍数，记录头不会跨越环尾
+    uint64_t* header(size_t pos) {
+        return (uint64_t*)(_buffer + (pos & _mask));
+    }
+
+    // data为NULL时只跳过；consume为true时推进读位置并清零读完的记录
+    size_t read(char* data, size_t size, bool consume) {
+        auto pos = _r_pos;
+        auto off = _r_off;
+        size_t read_size = 0;
+        // 只读不消费时记录头未清零，环满时最多读一圈
+        while (read_size < size && pos - _r_pos < _size) {
+            auto len = (size_t)__atomic_load_n(header(pos), __ATOMIC_ACQUIRE);
+            if (len == 0) {
+                break ;
+            }
+            auto n = len - off > size - read_size ? size - read_size : len - off;
+            if (data) {
+                copy_out(pos + RECORD_ALIGN + off, data + read_size, n);
+            }
+            read_size += n;
+            off += n;
+            if (off == len) {
+                if (consume) {
+                    zero(pos, record_size(len));
+                }
+                pos += record_size(len);
+                off = 0;
+            }
+        }
+        if (consume) {
+            _r_pos = pos;
+            _r_off = off;
+        }
+        return read_size;
+    }
+
+    void copy_in(size_t pos, const char* data, size_t size) {
+        auto index = pos & _mask;
+        auto n = _size - index > size ? size : _size - index;
+        memcpy(_buffer + index, data, n);
+        memcpy(_buffer, data + n, size - n);
+    }
+
+    void copy_out(size_t pos, char* data, size_t size) {
+        auto index = pos & _mask;
+        auto n = _size - index > size ? size : _size - index;
+        memcpy(data, _buffer + index, n);
+        memcpy(data + n, _buffer, size - n);
+    }
+
+    void zero(size_t pos, size_t size) {
+        auto index = pos & _mask;
+        auto n = _size - index > size ? size : _size - index;
+        memset(_buffer + index, 0, n);
+        memset(_buffer, 0, size - n);
+    }
+
+private:
+    char*   _buffer;
+    size_t  _size;
+    size_t  _mask;
+
+    // 消费者归还的位置
+    alignas(RBUFFER_CACHE_LINE) atomic<size_t>  _head;
+    // 生产者预留的位置
+    alignas(RBUFFER_CACHE_LINE) atomic<size_t>  _reserve;
+
+    // 消费者私有：当前记录起点及记录内已读偏移
+    alignas(RBUFFER_CACHE_LINE) size_t  _r_pos;
+    size_t  _r_off;
+
+    alignas(RBUFFER_CACHE_LINE) FutexWaiter _readable;
+    alignas(RBUFFER_CACHE_LINE) FutexWaiter _writable;
+};
+
+#endif
@@ -1,10 +1,12 @@
 #ifndef __NET_UTILS_H__
 #define __NET_UTILS_H__
 
+#include <stdint.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <linux/filter.h>
 
 class NetUtils
 {
@@ -30,6 +32,26 @@ public:
         int opt = on ? 1 : 0;
         return setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (const void*)&opt, sizeof(opt));
     }
+
+    // 需在bind前设置，同端口的多个socket组成一个reuseport组，由内核分发新连接
+    static int set_socket_reuseport(int fd, bool on = true) {
+        int opt = on ? 1 : 0;
+        return setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (const void*)&opt, sizeof(opt));
+    }
+
+    // 按处理软中断的cpu选择组内第(cpu % group_size)个socket(按加入组的顺序)，
+    // 附加到组内任意一个已bind的socket即可
+    static int set_reuseport_cpu_steering(int fd, int group_size) {
+        struct sock_filter code[] = {
+            {BPF_LD | BPF_W | BPF_ABS, 0, 0, (uint32_t)(SKF_AD_OFF + SKF_AD_CPU)},
+            {BPF_ALU | BPF_MOD | BPF_K, 0, 0, (uint32_t)group_size},
+            {BPF_RET | BPF_A, 0, 0, 0},
+        };
+        struct sock_fprog prog;
+        prog.len = sizeof(code) / sizeof(code[0]);
+        prog.filter = code;
+        return setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, (const void*)&prog, sizeof(prog));
+    }
 };
 
 #endif
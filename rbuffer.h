@@ -67,7 +67,7 @@ public:
     size_t pick(char* data, size_t size) {
         size_t get_size = used_size() > size ? size : used_size(); 
         if (get_size > 0) {
-			if (_r_pos + get_size > _w_pos && _w_pos > 0) {
+			if (_r_pos + get_size > _size) {
 				auto cp_size = _size - _r_pos;
 				memcpy(data, _buffer + _r_pos, cp_size);
 				memcpy(data + cp_size, _buffer, get_size - cp_size);
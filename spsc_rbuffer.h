@@ -0,0 +1,171 @@
+#ifndef __SPSC_RING_BUFFER_H__
+#define __SPSC_RING_BUFFER_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <stdexcept>
+
+#include "futex_waiter.h"
+
+using namespace std;
+
+const size_t RBUFFER_CACHE_LINE = 64;
+
+// 单生产者单消费者的定长字节环，无锁且无等待，用于loop线程与worker之间传递字节流。
+// 读写位置为单调递增的绝对值，各自独占cache line；双方缓存对端位置，只有缓存不足时才读共享变量。
+// set/get的commit参数为false时只推进本地位置，多次操作后以commit_set/commit_get一次发布
+class SpscRBuffer
+{
+public:
+    // 容量向上取整为2的幂
+    SpscRBuffer(size_t def_size = 1024 * 64) {
+        _size = 1;
+        while (_size < def_size) {
+            _size <<= 1;
+        }
+        _mask = _size - 1;
+        _buffer = (char*)malloc(_size);
+        if (!_buffer) {
+            throw runtime_error("malloc fail");
+        }
+        _head = 0;
+        _tail = 0;
+        _w_pos = 0;
+        _head_cache = 0;
+        _r_pos = 0;
+        _tail_cache = 0;
+    }
+
+    ~SpscRBuffer() {
+        free(_buffer);
+        _buffer = NULL;
+    }
+
+    SpscRBuffer(const SpscRBuffer&) = delete;
+    SpscRBuffer& operator=(const SpscRBuffer&) = delete;
+
+    // 生产者调用，空间不足时不写入并返回false
+    bool set(const char* data, size_t size, bool commit = true) {
+        if (size > _size - (_w_pos - _head_cache)) {
+            _head_cache = _head.load(memory_order_acquire);
+            if (size > _size - (_w_pos - _head_cache)) {
+                return false;
+            }
+        }
+        copy_in(_w_pos, data, size);
+        _w_pos += size;
+        if (commit) {
+            commit_set();
+        }
+        return true;
+    }
+
+    void commit_set() {
+        _tail.store(_w_pos, memory_order_release);
+        _readable.notify();
+    }
+
+    // 消费者调用
+    size_t get(char* data, size_t size, bool commit = true) {
+        auto get_size = pick(data, size);
+        _r_pos += get_size;
+        if (commit) {
+            commit_get();
+        }
+        return get_size;
+    }
+
+    size_t pick(char* data, size_t size) {
+        if (size > _tail_cache - _r_pos) {
+            _tail_cache = _tail.load(memory_order_acquire);
+        }
+        size_t get_size = _tail_cache - _r_pos > size ? size : _tail_cache - _r_pos;
+        copy_out(_r_pos, data, get_size);
+        return get_size;
+    }
+
+    size_t skip(size_t size, bool commit = true) {
+        if (size > _tail_cache - _r_pos) {
+            _tail_cache = _tail.load(memory_order_acquire);
+        }
+        size_t skip_size = _tail_cache - _r_pos > size ? size : _tail_cache - _r_pos;
+        _r_pos += skip_size;
+        if (commit) {
+            commit_get();
+        }
+        return skip_size;
+    }
+
+    void commit_get() {
+        _head.store(_r_pos, memory_order_release);
+        _writable.notify();
+    }
+
+    // 消费者阻塞等待至少size字节可读
+    bool wait_readable(size_t size = 1, int timeout_ms = -1) {
+        return _readable.wait([&] {return _tail.load(memory_order_acquire) - _r_pos >= size;}, timeout_ms);
+    }
+
+    // 生产者阻塞等待至少size字节可写
+    bool wait_writable(size_t size, int timeout_ms = -1) {
+        return _writable.wait([&] {return _size - (_w_pos - _head.load(memory_order_acquire)) >= size;}, timeout_ms);
+    }
+
+    // 以下为已发布数据的快照，跨线程读取时仅供参考
+	bool empty() {
+		return used_size() == 0;
+	}
+
+    size_t size() {
+        return _size;
+    }
+
+    size_t used_size() {
+        return _tail.load(memory_order_acquire) - _head.load(memory_order_acquire);
+    }
+
+    size_t left_size() {
+        return size() - used_size();
+    }
+
+private:
+    void copy_in(size_t pos, const char* data, size_t size) {
+        auto index = pos & _mask;
+        auto n = _size - index > size ? size : _size - index;
+        memcpy(_buffer + index, data, n);
+        memcpy(_buffer, data + n, size - n);
+    }
+
+    void copy_out(size_t pos, char* data, size_t size) {
+        auto index = pos & _mask;
+        auto n = _size - index > size ? size : _size - index;
+        memcpy(data, _buffer + index, n);
+        memcpy(data + n, _buffer, size - n);
+    }
+
+private:
+    // 只读字段
+    char*   _buffer;
+    size_t  _size;
+    size_t  _mask;
+
+    // 共享位置，各占一个cache line
+    alignas(RBUFFER_CACHE_LINE) atomic<size_t>  _head;
+    alignas(RBUFFER_CACHE_LINE) atomic<size_t>  _tail;
+
+    // 生产者私有
+    alignas(RBUFFER_CACHE_LINE) size_t  _w_pos;
+    size_t  _head_cache;
+
+    // 消费者私有
+    alignas(RBUFFER_CACHE_LINE) size_t  _r_pos;
+    size_t  _tail_cache;
+
+    alignas(RBUFFER_CACHE_LINE) FutexWaiter _readable;
+    alignas(RBUFFER_CACHE_LINE) FutexWaiter _writable;
+};
+
+#endif
@@ -0,0 +1,153 @@
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+
+#include "binary_stream.h"
+#include "test_check.h"
+
+using namespace std;
+
+// 两种字节序下定长整数往返，并核对线上字节
+static void test_order()
+{
+    Buffer buffer(4);
+    {
+        BufferWriter<true> writer(buffer);
+        writer.write_u16(0x0102);
+        writer.write_u32(0x03040506);
+        writer.write_u64(0x0708090a0b0c0d0eULL);
+    }
+    {
+        BufferWriter<false> writer(buffer);
+        writer.write_u16(0x0102);
+        writer.write_u32(0x03040506);
+        writer.write_u64(0x0708090a0b0c0d0eULL);
+    }
+    const char expect[] =
+        "\x01\x02" "\x03\x04\x05\x06" "\x07\x08\x09\x0a\x0b\x0c\x0d\x0e"
+        "\x02\x01" "\x06\x05\x04\x03" "\x0e\x0d\x0c\x0b\x0a\x09\x08\x07";
+    CHECK(buffer.used_size() == 28);
+    CHECK(memcmp(buffer.data(), expect, 28) == 0);
+
+    uint16_t u16;
+    uint32_t u32;
+    uint64_t u64;
+    BufferReader<true> big(buffer.data(), 14);
+    CHECK(big.read_u16(u16) && u16 == 0x0102);
+    CHECK(big.read_u32(u32) && u32 == 0x03040506);
+    CHECK(big.read_u64(u64) && u64 == 0x0708090a0b0c0d0eULL);
+    CHECK(big.remaining() == 0);
+    BufferReader<false> little(buffer.data() + 14, 14);
+    CHECK(little.read_u16(u16) && u16 == 0x0102);
+    CHECK(little.read_u32(u32) && u32 == 0x03040506);
+    CHECK(little.read_u64(u64) && u64 == 0x0708090a0b0c0d0eULL);
+    CHECK(little.consumed() == 14);
+}
+
+// varint边界值的编码长度与往返；11字节(续位未结束)的输入被拒绝
+static void test_varint()
+{
+    const uint64_t values[] = {0, 127, 128, 16383, 16384, UINT64_MAX};
+    const size_t sizes[] = {1, 1, 2, 2, 3, 10};
+    Buffer buffer(1);
+    {
+        BufferWriter<> writer(buffer);
+        for (auto v : values) {
+            writer.write_varint(v);
+        }
+    }
+    BufferReader<> reader(buffer);
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        uint64_t v = 1;
+        auto before = reader.consumed();
+        CHECK(reader.peek_varint(v) && v == values[i]);
+        CHECK(reader.consumed() == before);
+        CHECK(reader.read_varint(v) && v == values[i]);
+        CHECK(reader.consumed() - before == sizes[i]);
+    }
+    CHECK(reader.remaining() == 0);
+
+    string bad(10, (char)0x80);
+    bad.push_back(0x01);
+    BufferReader<> bad_reader(bad);
+    uint64_t v;
+    CHECK(!bad_reader.read_varint(v));
+    CHECK(bad_reader.consumed() == 0);
+}
+
+// 预留的长度字段在之后的写入触发Buffer搬移(move)与扩容(realloc)后仍能正确回填
+static void test_backpatch()
+{
+    Buffer buffer(16);
+    // 读位置不在起点，下一次reserve先memmove再realloc
+    buffer.set("0123456789", 10);
+    buffer.skip(6);
+    string body(1000, 'b');
+    {
+        BufferWriter<> writer(buffer);
+        auto pos = writer.reserve_u32();
+        auto start = writer.position();
+        writer.write_u16(0xbeef);
+        auto inner = writer.reserve_u32();
+        writer.write_bytes(body);
+        writer.patch_u32(inner, (uint32_t)body.size());
+        writer.write_varint(300);
+        writer.patch_u32(pos, (uint32_t)(writer.position() - start));
+    }
+    CHECK(buffer.size() > 16);
+    BufferReader<> reader(buffer);
+    string head(4, 0);
+    uint32_t len;
+    uint16_t magic;
+    uint32_t inner_len;
+    uint64_t tail;
+    CHECK(reader.read_bytes(&head[0], 4) && head == "6789");
+    CHECK(reader.read_u32(len) && len == 2 + 4 + body.size() + 2);
+    CHECK(reader.read_u16(magic) && magic == 0xbeef);
+    CHECK(reader.read_u32(inner_len) && inner_len == body.size());
+    string_view view;
+    CHECK(reader.read_view(view, inner_len) && view == body);
+    CHECK(reader.read_varint(tail) && tail == 300);
+    CHECK(reader.remaining() == 0);
+    buffer.skip(reader.consumed());
+    CHECK(buffer.used_size() == 0);
+}
+
+// 数据不足时各读接口返回false且不移动读位置
+static void test_short_read()
+{
+    const char data[] = "\x01\x02\x03\x80\x80";
+    BufferReader<> reader(data, 3);
+    uint16_t u16;
+    uint32_t u32;
+    uint64_t u64;
+    CHECK(!reader.read_u32(u32));
+    CHECK(!reader.read_u64(u64));
+    CHECK(!reader.peek_u32(u32));
+    char out[4];
+    CHECK(!reader.read_bytes(out, 4));
+    string_view view;
+    CHECK(!reader.read_view(view, 4));
+    CHECK(!reader.skip(4));
+    CHECK(reader.consumed() == 0 && reader.remaining() == 3);
+    CHECK(reader.read_u16(u16) && u16 == 0x0102);
+    CHECK(!reader.read_u16(u16));
+    CHECK(reader.consumed() == 2);
+
+    // varint在数据末尾未结束
+    BufferReader<> partial(data + 3, 2);
+    uint64_t v;
+    CHECK(!partial.read_varint(v));
+    CHECK(partial.consumed() == 0);
+}
+
+int main()
+{
+    test_order();
+    test_varint();
+    test_backpatch();
+    test_short_read();
+    printf("test_binary_stream ok\n");
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+
+#include "epoll_engine/epoll_channel.h"
+#include "epoll_engine/epoll_executor.h"
+#include "net_utils.h"
+#include "test_check.h"
+
+using namespace std;
+
+// 发送出错的回调中再次发送，验证回调时不持有_mutex
+class ResendConnect : public EpollChannelConnect
+{
+public:
+    using EpollChannelConnect::EpollChannelConnect;
+
+    void on_close() {
+        _resend = send_buffer(string("again"));
+        _closed++;
+    }
+
+    void on_error(int error) {
+        _resend = send_buffer(string("again"));
+        _errors++;
+    }
+
+    atomic<int>     _closed = {0};
+    atomic<int>     _errors = {0};
+    atomic<bool>    _resend = {true};
+};
+
+static shared_ptr<ResendConnect> make_connect(shared_ptr<EpollEngine> engine, int fds[2])
+{
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    NetUtils::set_socket_unblock(fds[0]);
+    auto conn = make_shared<ResendConnect>(engine, fds[0]);
+    CHECK(conn->init());
+    return conn;
+}
+
+template <class F>
+static bool wait_for(F cond, int timeout_ms)
+{
+    for (int i = 0; i < timeout_ms && !cond(); i++) {
+        usleep(1000);
+    }
+    return cond();
+}
+
+// send_buffer直接写出时对端已不可读：EPIPE在send_buffer所在线程回调on_close
+static void test_send_fail_direct(shared_ptr<EpollEngine> engine)
+{
+    int fds[2];
+    auto conn = make_connect(engine, fds);
+    CHECK(shutdown(fds[1], SHUT_RD) == 0);
+    CHECK(!conn->send_buffer(string("hello")));
+    CHECK(conn->_closed.load() == 1);
+    CHECK(!conn->_resend.load());
+    CHECK(conn->is_released());
+    close(fds[1]);
+}
+
+// 队列积压后由可写事件继续发送时出错：回调在loop线程执行，只回调一次
+static void test_send_fail_queued(shared_ptr<EpollEngine> engine)
+{
+    int fds[2];
+    auto conn = make_connect(engine, fds);
+    string block(1024 * 1024, 'x');
+    for (int i = 0; i < 8; i++) {
+        CHECK(conn->send_buffer(block));
+    }
+    CHECK(shutdown(fds[1], SHUT_RD) == 0);
+    conn->on_send();
+    CHECK(wait_for([&] {return conn->_closed.load() + conn->_errors.load() > 0;}, 1000));
+    usleep(10000);
+    CHECK(conn->_closed.load() + conn->_errors.load() == 1);
+    CHECK(!conn->_resend.load());
+    close(fds[1]);
+}
+
+// 对端慢读使发送队列积压，io_uring后端下经由复用的sendmsg请求写出，数据完整有序
+static void test_send_order(EpollBackend backend)
+{
+    auto engine = make_shared<EpollEngine>(1, 16, backend);
+    int fds[2];
+    auto conn = make_connect(engine, fds);
+    const int count = 20000;
+    string expect;
+    for (int i = 0; i < count; i++) {
+        string msg(1 + i % 300, (char)('a' + i % 26));
+        expect += msg;
+        CHECK(conn->send_buffer(std::move(msg)));
+    }
+    string out;
+    char buf[4096];
+    while (out.size() < expect.size()) {
+        auto n = read(fds[1], buf, sizeof(buf));
+        CHECK(n > 0);
+        out.append(buf, n);
+        if (out.size() % 7 == 0) {
+            usleep(100);
+        }
+    }
+    CHECK(out == expect);
+    CHECK(conn->_closed.load() == 0 && conn->_errors.load() == 0);
+    close(fds[1]);
+    engine->terminate();
+}
+
+int main()
+{
+    auto engine = make_shared<EpollEngine>(1, 16);
+    test_send_fail_direct(engine);
+    test_send_fail_queued(engine);
+    engine->terminate();
+    // io_uring不可用时引擎自动退回epoll
+    for (auto backend : {EPOLL_BACKEND_EPOLL, EPOLL_BACKEND_URING}) {
+        test_send_order(backend);
+    }
+    printf("test_channel ok\n");
+    return 0;
+}
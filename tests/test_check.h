@@ -0,0 +1,15 @@
+#ifndef __TEST_CHECK_H__
+#define __TEST_CHECK_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// 不依赖assert，Release构建下同样生效
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("%s:%d|check fail: %s\n", __FILE__, __LINE__, #cond); \
+        exit(1); \
+    } \
+} while (0)
+
+#endif
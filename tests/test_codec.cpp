@@ -0,0 +1,335 @@
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "epoll_engine/epoll_codec.h"
+#include "epoll_engine/epoll_executor.h"
+#include "net_utils.h"
+#include "test_check.h"
+
+using namespace std;
+
+static string make_body(size_t size, char c)
+{
+    string body(size, c);
+    for (size_t i = 0; i < size; i += 7) {
+        body[i] = (char)(c + i % 5);
+    }
+    return body;
+}
+
+// 4字节大端长度 + 负载
+static string make_length_frame(const string& body)
+{
+    string frame;
+    for (int i = 3; i >= 0; i--) {
+        frame.push_back((char)(body.size() >> (8 * i)));
+    }
+    return frame + body;
+}
+
+static string make_varint_frame(const string& body)
+{
+    string frame;
+    uint64_t len = body.size();
+    do {
+        auto b = (unsigned char)(len & 0x7f);
+        len >>= 7;
+        frame.push_back((char)(len ? b | 0x80 : b));
+    } while (len);
+    return frame + body;
+}
+
+// 帧头2字节魔数 + 2字节小端长度(计整帧) + 2字节保留
+class MagicCodec : public EpollFixedHeaderCodec<6, 2, 2, false>
+{
+public:
+    MagicCodec() : EpollFixedHeaderCodec(CODEC_DEF_MAX_FRAME, true) {}
+};
+
+static string make_magic_frame(const string& body)
+{
+    auto len = body.size() + 6;
+    string frame = "MG";
+    frame.push_back((char)(len & 0xff));
+    frame.push_back((char)(len >> 8));
+    frame.append(2, 0);
+    return frame + body;
+}
+
+template <class Codec>
+class CodecConnect : public EpollCodecChannel<Codec>
+{
+public:
+    using EpollCodecChannel<Codec>::EpollCodecChannel;
+
+    bool on_message(string_view frame, size_t header_size) {
+        _messages.emplace_back(frame);
+        _headers.push_back(header_size);
+        return true;
+    }
+
+    void on_error(int error) {
+        _error = error;
+    }
+
+    vector<string>  _messages;
+    vector<size_t>  _headers;
+    int _error = 0;
+};
+
+template <class Codec>
+static shared_ptr<CodecConnect<Codec>> make_connect(shared_ptr<EpollEngine> engine, int fds[2])
+{
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    NetUtils::set_socket_unblock(fds[0]);
+    auto conn = make_shared<CodecConnect<Codec>>(engine, fds[0]);
+    CHECK(conn->init());
+    return conn;
+}
+
+static size_t block_size()
+{
+    ChainBuffer probe;
+    probe.reserve(1);
+    return probe.capacity();
+}
+
+// 首帧几乎填满block，第二帧的帧头跨越block；之后逐字节送达一帧，最后分多次送达一个超过block的大帧
+template <class Codec, class Make>
+static void check_split(shared_ptr<EpollEngine> engine, Make make)
+{
+    int fds[2];
+    auto conn = make_connect<Codec>(engine, fds);
+    auto block = block_size();
+    vector<string> bodies;
+    bodies.push_back(make_body(block - 10, 'a'));
+    bodies.push_back(make_body(300, 'b'));
+    bodies.push_back(make_body(17, 'c'));
+    // 2字节长度字段的帧不超过65535
+    bodies.push_back(make_body(min(block * 3, (size_t)60000), 'd'));
+    vector<string> frames;
+    for (auto& body : bodies) {
+        frames.push_back(make(body));
+    }
+
+    auto first = frames[0] + frames[1].substr(0, 3);
+    conn->on_recv(first.data(), first.size());
+    CHECK(conn->_messages.size() == 1);
+    auto rest = frames[1].substr(3);
+    conn->on_recv(rest.data(), rest.size());
+    CHECK(conn->_messages.size() == 2);
+    for (auto c : frames[2]) {
+        conn->on_recv(&c, 1);
+    }
+    CHECK(conn->_messages.size() == 3);
+    for (size_t off = 0; off < frames[3].size(); off += 4099) {
+        auto len = min((size_t)4099, frames[3].size() - off);
+        conn->on_recv(frames[3].data() + off, len);
+    }
+    CHECK(conn->_messages == frames);
+    for (size_t i = 0; i < frames.size(); i++) {
+        CHECK(conn->_headers[i] == frames[i].size() - bodies[i].size());
+    }
+    CHECK(conn->_error == 0);
+    close(fds[1]);
+}
+
+// 直接调用decode：帧头分多次到达，已判定的帧长保留到数据到齐
+static void test_header_decode()
+{
+    EpollLengthCodec<4> codec;
+    auto frame = make_length_frame(make_body(100, 'x'));
+    size_t header_size = 0;
+    for (size_t size = 0; size < frame.size(); size++) {
+        CHECK(codec.decode(frame.data(), size, header_size) == CODEC_AGAIN);
+    }
+    CHECK(codec.decode(frame.data(), frame.size(), header_size) == (int)frame.size());
+    CHECK(header_size == 4);
+
+    // 小端2字节长度
+    EpollLengthCodec<2, false> little;
+    string body = make_body(0x0102, 'y');
+    string data = string("\x02\x01", 2) + body;
+    CHECK(little.decode(data.data(), data.size(), header_size) == (int)data.size());
+
+    MagicCodec magic;
+    auto m = make_magic_frame(make_body(10, 'z'));
+    CHECK(magic.decode(m.data(), 5, header_size) == CODEC_AGAIN);
+    CHECK(magic.decode(m.data(), m.size(), header_size) == (int)m.size());
+    CHECK(header_size == 6);
+    // 计整帧时长度小于帧头为格式错误
+    string bad = "MG";
+    bad.append("\x03\x00\x00\x00", 4);
+    CHECK(magic.decode(bad.data(), bad.size(), header_size) == CODEC_ERROR);
+}
+
+// varint：最长5字节，超长或超过max_frame均拒绝
+static void test_varint_decode()
+{
+    size_t header_size = 0;
+    for (size_t len : {(size_t)0, (size_t)1, (size_t)127, (size_t)128, (size_t)16383, (size_t)16384, (size_t)70000}) {
+        EpollVarintCodec codec;
+        auto frame = make_varint_frame(make_body(len, 'v'));
+        auto head = frame.size() - len;
+        for (size_t size = 0; size < frame.size(); size += (size < head ? 1 : 997)) {
+            CHECK(codec.decode(frame.data(), size, header_size) == CODEC_AGAIN);
+        }
+        CHECK(codec.decode(frame.data(), frame.size(), header_size) == (int)frame.size());
+        CHECK(header_size == head);
+    }
+
+    // 6字节与11字节的varint(续位未结束)
+    for (size_t n : {(size_t)6, (size_t)11}) {
+        EpollVarintCodec codec;
+        string data(n, (char)0x80);
+        data += "tail";
+        CHECK(codec.decode(data.data(), data.size(), header_size) == CODEC_ERROR);
+    }
+    // 5字节编码的值超出32位
+    {
+        EpollVarintCodec codec((size_t)1 << 40);
+        string data("\xff\xff\xff\xff\x7f", 5);
+        CHECK(codec.decode(data.data(), data.size(), header_size) == CODEC_ERROR);
+    }
+    // 超过max_frame，帧头到齐即拒绝，不等帧体
+    {
+        EpollVarintCodec codec(1000);
+        auto frame = make_varint_frame(make_body(1001, 'w'));
+        CHECK(codec.decode(frame.data(), 2, header_size) == CODEC_ERROR);
+        EpollVarintCodec exact(1000);
+        auto ok = make_varint_frame(make_body(1000, 'w'));
+        CHECK(exact.decode(ok.data(), ok.size(), header_size) == (int)ok.size());
+    }
+}
+
+// 分隔符查找从上次扫描位置继续；数据被搬到新地址(pullup)后按偏移继续；多字节分隔符跨越两次送达
+static void test_delimiter_decode()
+{
+    size_t header_size = 0;
+    EpollDelimiterCodec codec("\r\n");
+    string line = make_body(5000, 'l') + "\r\n" + "next";
+    CHECK(codec.decode(line.data(), 1000, header_size) == CODEC_AGAIN);
+    CHECK(codec.decode(line.data(), 5001, header_size) == CODEC_AGAIN);
+    string moved(line);
+    CHECK(codec.decode(moved.data(), 5001, header_size) == CODEC_AGAIN);
+    CHECK(codec.decode(moved.data(), moved.size(), header_size) == 5002);
+    CHECK(header_size == 0);
+    // 成功后从头扫描下一帧
+    string second = "ab\r\r\n";
+    CHECK(codec.decode(second.data(), second.size(), header_size) == 5);
+
+    // 首字节匹配但后续不匹配的位置被跳过
+    EpollDelimiterCodec fake("\r\n");
+    string noise = "a\rb\rc\r\n";
+    CHECK(fake.decode(noise.data(), noise.size(), header_size) == (int)noise.size());
+
+    // 无分隔符且已扫描到max_frame时拒绝
+    EpollDelimiterCodec limit("\n", 64);
+    string longline(64, 'q');
+    CHECK(limit.decode(longline.data(), 63, header_size) == CODEC_AGAIN);
+    CHECK(limit.decode(longline.data(), 64, header_size) == CODEC_ERROR);
+    EpollDelimiterCodec over("\n", 64);
+    string overline = string(64, 'q') + "\n";
+    CHECK(over.decode(overline.data(), overline.size(), header_size) == CODEC_ERROR);
+}
+
+// 向量化查找与memchr在各种起始对齐和尾部长度下结果一致
+static void test_find_byte()
+{
+    vector<char> buf(256 + 64);
+    for (size_t i = 0; i < buf.size(); i++) {
+        buf[i] = (char)('a' + i % 23);
+    }
+    for (size_t offset = 0; offset < 33; offset++) {
+        for (size_t len = 0; len <= 200; len++) {
+            auto begin = buf.data() + offset;
+            auto end = begin + len;
+            for (size_t hit = 0; hit <= len; hit += (len > 40 ? 7 : 1)) {
+                char saved = 0;
+                if (hit < len) {
+                    saved = begin[hit];
+                    begin[hit] = '\n';
+                }
+                auto expect = (const char*)memchr(begin, '\n', len);
+                expect = expect ? expect : end;
+                CHECK(codec_find_byte(begin, end, '\n') == expect);
+#ifdef EPOLL_CODEC_X86
+                CHECK(codec_find_byte_sse2(begin, end, '\n') == expect);
+                if (__builtin_cpu_supports("avx2")) {
+                    CHECK(codec_find_byte_avx2(begin, end, '\n') == expect);
+                }
+#endif
+                if (hit < len) {
+                    begin[hit] = saved;
+                }
+            }
+        }
+    }
+}
+
+// 分隔符在channel中跨越block：首行几乎填满block，第二行的"\r\n"落在两个block之间
+static void test_delimiter_channel(shared_ptr<EpollEngine> engine)
+{
+    int fds[2];
+    auto conn = make_connect<EpollDelimiterCodec>(engine, fds);
+    conn->get_codec().set_delimiter("\r\n");
+    auto block = block_size();
+    vector<string> lines;
+    lines.push_back(make_body(block - 40, 'a') + "\r\n");
+    lines.push_back(make_body(36, 'b') + "\r\n");
+    lines.push_back(make_body(block * 2, 'c') + "\r\n");
+    auto first = lines[0] + lines[1].substr(0, lines[1].size() - 1);
+    conn->on_recv(first.data(), first.size());
+    CHECK(conn->_messages.size() == 1);
+    auto rest = lines[1].substr(lines[1].size() - 1) + lines[2].substr(0, 1000);
+    conn->on_recv(rest.data(), rest.size());
+    CHECK(conn->_messages.size() == 2);
+    for (size_t off = 1000; off < lines[2].size(); off += 3001) {
+        auto len = min((size_t)3001, lines[2].size() - off);
+        conn->on_recv(lines[2].data() + off, len);
+    }
+    CHECK(conn->_messages == lines);
+    close(fds[1]);
+}
+
+// 超过max_frame时get_frame返回负数，连接以EPROTO出错并释放
+static void test_max_frame(shared_ptr<EpollEngine> engine)
+{
+    int fds[2];
+    auto conn = make_connect<EpollLengthCodec<4>>(engine, fds);
+    conn->get_codec().set_max_frame(1024);
+    size_t header_size = 0;
+    auto frame = make_length_frame(make_body(1021, 'm'));
+    CHECK(conn->get_frame(frame.data(), frame.size(), header_size) < 0);
+    auto ok = make_length_frame(make_body(1020, 'm'));
+    conn->on_recv(ok.data(), ok.size());
+    CHECK(conn->_messages.size() == 1 && conn->_error == 0);
+    conn->on_recv(frame.data(), 8);
+    CHECK(conn->_messages.size() == 1);
+    CHECK(conn->_error == EPROTO);
+    CHECK(conn->is_released());
+    close(fds[1]);
+}
+
+int main()
+{
+    test_header_decode();
+    test_varint_decode();
+    test_delimiter_decode();
+    test_find_byte();
+
+    auto engine = make_shared<EpollEngine>(1, 16);
+    check_split<EpollLengthCodec<4>>(engine, make_length_frame);
+    check_split<MagicCodec>(engine, make_magic_frame);
+    check_split<EpollVarintCodec>(engine, make_varint_frame);
+    test_delimiter_channel(engine);
+    test_max_frame(engine);
+    engine->terminate();
+    printf("test_codec ok\n");
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "epoll_engine/epoll_executor.h"
+#include "test_check.h"
+
+using namespace std;
+
+// 超过EPOLL_TASK_BATCH的积压在terminate时全部执行
+static void test_drain_on_terminate(EpollBackend backend)
+{
+    auto engine = make_shared<EpollEngine>(2, 16, backend);
+    atomic<int> ran(0);
+    atomic<bool> release(false);
+    // 先阻塞loop，使任务在队列中积压
+    CHECK(engine->post(0, [&]() {
+        while (!release.load()) {
+            usleep(100);
+        }
+    }));
+    const int count = EPOLL_TASK_BATCH * 3;
+    for (int i = 0; i < count; i++) {
+        CHECK(engine->post(i % 2, [&]() {ran++;}));
+    }
+    thread stopper([&]() {
+        engine->terminate();
+    });
+    usleep(10000);
+    release = true;
+    stopper.join();
+    CHECK(ran.load() == count);
+    CHECK(!engine->post(0, [&]() {ran++;}));
+}
+
+// 与terminate并发的post：返回true的任务恰好都执行，返回false的都不执行
+static void test_post_race(EpollBackend backend)
+{
+    for (int round = 0; round < 20; round++) {
+        auto engine = make_shared<EpollEngine>(2, 16, backend);
+        atomic<int> ran(0);
+        atomic<int> accepted(0);
+        vector<thread> posters;
+        for (int t = 0; t < 4; t++) {
+            posters.emplace_back([&, t]() {
+                for (int i = 0; i < 20000; i++) {
+                    if (engine->post((t + i) % 2, [&]() {ran++;})) {
+                        accepted++;
+                    }
+                }
+            });
+        }
+        usleep(round * 200);
+        engine->terminate();
+        for (auto& item : posters) {
+            item.join();
+        }
+        CHECK(ran.load() == accepted.load());
+    }
+}
+
+int main()
+{
+    // io_uring不可用时引擎自动退回epoll
+    for (auto backend : {EPOLL_BACKEND_EPOLL, EPOLL_BACKEND_URING}) {
+        test_drain_on_terminate(backend);
+        test_post_race(backend);
+    }
+    printf("test_engine ok\n");
+    return 0;
+}
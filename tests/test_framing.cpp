@@ -0,0 +1,125 @@
+#include <sys/socket.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "epoll_engine/epoll_channel.h"
+#include "epoll_engine/epoll_executor.h"
+#include "net_utils.h"
+#include "test_check.h"
+
+using namespace std;
+
+// 4字节网络序长度 + 负载
+static string make_frame(size_t len, char c)
+{
+    uint32_t n = htonl((uint32_t)len);
+    string frame((const char*)&n, sizeof(n));
+    frame.append(len, c);
+    return frame;
+}
+
+static int frame_length(const char* data, size_t size)
+{
+    if (size < sizeof(uint32_t)) {
+        return 0;
+    }
+    uint32_t n;
+    memcpy(&n, data, sizeof(n));
+    size_t len = sizeof(n) + ntohl(n);
+    return size < len ? 0 : (int)len;
+}
+
+// 拷贝分帧，不完整时按老代码的习惯返回-1
+class LegacyConnect : public EpollChannelConnect
+{
+public:
+    using EpollChannelConnect::EpollChannelConnect;
+
+    bool on_message(const string& buffer) {
+        _messages.push_back(buffer);
+        return true;
+    }
+
+    int get_packet(const char* data, size_t size, string& buffer) {
+        auto len = frame_length(data, size);
+        if (len == 0) {
+            return -1;
+        }
+        buffer.assign(data, len);
+        return len;
+    }
+
+    vector<string> _messages;
+};
+
+// 原地分帧，不完整时返回0
+class FrameConnect : public EpollChannelConnect
+{
+public:
+    using EpollChannelConnect::EpollChannelConnect;
+
+    bool on_message(string_view frame, size_t header_size) {
+        CHECK(header_size == sizeof(uint32_t));
+        _messages.emplace_back(frame);
+        return true;
+    }
+
+    int get_frame(const char* data, size_t size, size_t& header_size) {
+        header_size = sizeof(uint32_t);
+        return frame_length(data, size);
+    }
+
+    vector<string> _messages;
+};
+
+// 先填满首个block只留不足一帧的空间，使下一帧跨越两个block，再分两次送达
+template<class T>
+static void check_split(shared_ptr<EpollEngine> engine)
+{
+    int fds[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    NetUtils::set_socket_unblock(fds[0]);
+    auto conn = make_shared<T>(engine, fds[0]);
+    CHECK(conn->init());
+
+    ChainBuffer probe;
+    probe.reserve(1);
+    auto block = probe.capacity();
+    auto head = make_frame(block - 100, 'a');
+    auto split = make_frame(1000, 'b');
+    auto tail = make_frame(10, 'c');
+
+    // head被消费后剩余的半帧仍在首个block末尾，余下部分落入第二个block
+    conn->on_recv((head + split.substr(0, 50)).data(), head.size() + 50);
+    CHECK(conn->_messages.size() == 1);
+    CHECK(conn->_messages[0] == head);
+    auto rest = split.substr(50) + tail;
+    conn->on_recv(rest.data(), rest.size());
+    CHECK(conn->_messages.size() == 3);
+    CHECK(conn->_messages[1] == split);
+    CHECK(conn->_messages[2] == tail);
+
+    // 单帧大于一个block，分多次送达
+    auto big = make_frame(block * 3, 'd');
+    for (size_t off = 0; off < big.size(); off += 5000) {
+        auto len = big.size() - off < 5000 ? big.size() - off : 5000;
+        conn->on_recv(big.data() + off, len);
+    }
+    CHECK(conn->_messages.size() == 4);
+    CHECK(conn->_messages[3] == big);
+    close(fds[1]);
+}
+
+int main()
+{
+    auto engine = make_shared<EpollEngine>(1, 16);
+    check_split<LegacyConnect>(engine);
+    check_split<FrameConnect>(engine);
+    engine->terminate();
+    printf("test_framing ok\n");
+    return 0;
+}
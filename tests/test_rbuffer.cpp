@@ -0,0 +1,210 @@
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mirror_rbuffer.h"
+#include "spsc_rbuffer.h"
+#include "mpsc_rbuffer.h"
+#include "test_check.h"
+
+using namespace std;
+
+static string make_data(size_t size, int seed)
+{
+    string data(size, 0);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = (char)(i * 31 + seed);
+    }
+    return data;
+}
+
+// 回绕后的可读区域仍然连续；扩容时分别走搬环尾和搬环头两条路径
+static void test_mirror()
+{
+    MirrorRBuffer buf(1);
+    auto size = buf.size();
+    CHECK(size > 0 && size % sysconf(_SC_PAGESIZE) == 0);
+
+    auto a = make_data(size - 100, 1);
+    buf.set(a.data(), a.size());
+    buf.skip(a.size() - 10);
+    auto b = make_data(200, 2);
+    buf.set(b.data(), b.size());
+    CHECK(buf.used_size() == 210);
+    CHECK(memcmp(buf.read_ptr(), a.data() + a.size() - 10, 10) == 0);
+    CHECK(memcmp(buf.read_ptr() + 10, b.data(), b.size()) == 0);
+
+    // 扩容前环尾110字节、环头100字节：搬移环头
+    auto c = make_data(size, 3);
+    buf.set(c.data(), c.size());
+    CHECK(buf.size() == size * 2);
+    auto expect = a.substr(a.size() - 10) + b + c;
+    CHECK(buf.used_size() == expect.size());
+    CHECK(memcmp(buf.read_ptr(), expect.data(), expect.size()) == 0);
+
+    // 扩容前环尾12字节、环头92字节：搬移环尾
+    MirrorRBuffer buf2(1);
+    auto d = make_data(size - 8, 4);
+    buf2.set(d.data(), d.size());
+    buf2.skip(d.size() - 4);
+    buf2.set(c.data(), 100);
+    buf2.set(c.data(), c.size());
+    CHECK(buf2.size() == size * 2);
+    expect = d.substr(d.size() - 4) + c.substr(0, 100) + c;
+    CHECK(buf2.used_size() == expect.size());
+    CHECK(memcmp(buf2.read_ptr(), expect.data(), expect.size()) == 0);
+
+    string out(expect.size(), 0);
+    CHECK(buf2.get(&out[0], out.size()) == expect.size());
+    CHECK(out == expect);
+    CHECK(buf2.empty());
+}
+
+static void test_spsc_single()
+{
+    SpscRBuffer buf(100);
+    CHECK(buf.size() == 128);
+    auto a = make_data(100, 1);
+    CHECK(buf.set(a.data(), a.size()));
+    CHECK(!buf.set(a.data(), 29));
+    CHECK(buf.set(a.data(), 28));
+    CHECK(buf.used_size() == 128);
+
+    char out[128];
+    CHECK(buf.get(out, 60) == 60);
+    CHECK(memcmp(out, a.data(), 60) == 0);
+
+    // 不提交时对端看不到，提交后一次发布
+    CHECK(buf.set(a.data(), 30, false));
+    CHECK(buf.used_size() == 68);
+    CHECK(buf.set(a.data() + 30, 30, false));
+    buf.commit_set();
+    CHECK(buf.used_size() == 128);
+
+    CHECK(buf.get(out, 40) == 40);
+    CHECK(memcmp(out, a.data() + 60, 40) == 0);
+    CHECK(buf.get(out, 128) == 88);
+    CHECK(memcmp(out, a.data(), 28) == 0);
+    CHECK(memcmp(out + 28, a.data(), 60) == 0);
+    CHECK(buf.empty());
+}
+
+// 生产者写入连续序号，消费者按任意粒度读取并校验顺序
+static void test_spsc_threads()
+{
+    const uint32_t count = 1000000;
+    SpscRBuffer buf(4096);
+    thread producer([&]() {
+        uint32_t batch[37];
+        uint32_t seq = 0;
+        while (seq < count) {
+            size_t n = 0;
+            while (n < 37 && seq < count) {
+                batch[n++] = seq++;
+            }
+            while (!buf.set((const char*)batch, n * sizeof(uint32_t))) {
+                buf.wait_writable(n * sizeof(uint32_t));
+            }
+        }
+    });
+
+    string pending;
+    uint32_t expect = 0;
+    char out[333];
+    while (expect < count) {
+        auto n = buf.get(out, sizeof(out));
+        if (n == 0) {
+            buf.wait_readable();
+            continue ;
+        }
+        pending.append(out, n);
+        size_t off = 0;
+        for (; off + sizeof(uint32_t) <= pending.size(); off += sizeof(uint32_t)) {
+            uint32_t seq;
+            memcpy(&seq, pending.data() + off, sizeof(seq));
+            CHECK(seq == expect);
+            expect++;
+        }
+        pending.erase(0, off);
+    }
+    producer.join();
+    CHECK(buf.empty());
+}
+
+static void test_mpsc_single()
+{
+    MpscRBuffer buf(128);
+    CHECK(buf.size() == 128);
+    auto a = make_data(100, 1);
+    // 记录头8字节并按8字节对齐
+    CHECK(buf.set(a.data(), 50));
+    CHECK(buf.used_size() == 64);
+    CHECK(buf.set(a.data() + 50, 50));
+    CHECK(!buf.set(a.data(), 1));
+
+    char out[128];
+    CHECK(buf.pick(out, 128) == 100);
+    CHECK(memcmp(out, a.data(), 100) == 0);
+    CHECK(buf.get(out, 30) == 30);
+    CHECK(buf.get(out + 30, 70) == 70);
+    CHECK(memcmp(out, a.data(), 100) == 0);
+    CHECK(buf.empty());
+
+    // 归还后记录可回绕写入
+    CHECK(buf.set(a.data(), 100));
+    CHECK(buf.get(out, 128) == 100);
+    CHECK(memcmp(out, a.data(), 100) == 0);
+}
+
+// 多个生产者写入(编号,序号)记录，消费者校验记录完整且每个生产者内有序
+static void test_mpsc_threads()
+{
+    const int producer_count = 4;
+    const uint32_t count = 200000;
+    MpscRBuffer buf(4096);
+    vector<thread> producers;
+    for (int i = 0; i < producer_count; i++) {
+        producers.emplace_back([&buf, i, count]() {
+            for (uint32_t seq = 0; seq < count; seq++) {
+                uint32_t record[4] = {(uint32_t)i, seq, ~seq, (uint32_t)i};
+                while (!buf.set((const char*)record, sizeof(record))) {
+                    buf.wait_writable(sizeof(record));
+                }
+            }
+        });
+    }
+
+    vector<uint32_t> expect(producer_count, 0);
+    uint32_t total = 0;
+    while (total < count * producer_count) {
+        uint32_t record[4];
+        auto n = buf.get((char*)record, sizeof(record));
+        if (n == 0) {
+            buf.wait_readable(10);
+            continue ;
+        }
+        CHECK(n == sizeof(record));
+        CHECK(record[0] < (uint32_t)producer_count && record[3] == record[0]);
+        CHECK(record[1] == expect[record[0]] && record[2] == ~record[1]);
+        expect[record[0]]++;
+        total++;
+    }
+    for (auto& item : producers) {
+        item.join();
+    }
+    CHECK(buf.empty());
+}
+
+int main()
+{
+    test_mirror();
+    test_spsc_single();
+    test_spsc_threads();
+    test_mpsc_single();
+    test_mpsc_threads();
+    printf("test_rbuffer ok\n");
+    return 0;
+}
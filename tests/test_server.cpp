@@ -0,0 +1,103 @@
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "epoll_engine/epoll_channel.h"
+#include "epoll_engine/epoll_executor.h"
+#include "test_check.h"
+
+using namespace std;
+
+const int TEST_PORT = 19191;
+
+static mutex g_mutex;
+static vector<pair<int, int>> g_accepted;     // (accept所在loop, 分配的loop)
+
+class LoopConnect : public EpollChannelConnect
+{
+public:
+    LoopConnect(shared_ptr<EpollEngine> engine, int fd) : EpollChannelConnect(engine, fd) {
+        _accept_loop = engine->get_current_loop();
+    }
+
+    bool init() {
+        {
+            lock_guard<mutex> lock(g_mutex);
+            g_accepted.emplace_back(_accept_loop, get_loop_index());
+        }
+        return EpollChannelConnect::init();
+    }
+
+private:
+    int _accept_loop;
+};
+
+class FactoryServer : public EpollChannelServer
+{
+public:
+    using EpollChannelServer::EpollChannelServer;
+
+protected:
+    void on_accept() {}
+};
+
+static int connect_local()
+{
+    auto fd = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(fd != -1);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(TEST_PORT);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    CHECK(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    return fd;
+}
+
+// reuseport未指定balancer时连接留在内核分流到的loop
+static void test_reuseport_local()
+{
+    const int count = 64;
+    auto engine = make_shared<EpollEngine>(4, 1024);
+    auto server = make_shared<FactoryServer>(engine, "127.0.0.1", TEST_PORT, 128);
+    server->set_reuseport(true);
+    server->set_connect_factory([](shared_ptr<EpollEngine> engine, int fd) {
+        return make_shared<LoopConnect>(engine, fd);
+    });
+    CHECK(server->init());
+
+    vector<int> fds;
+    for (int i = 0; i < count; i++) {
+        fds.push_back(connect_local());
+    }
+    for (int i = 0; i < 2000; i++) {
+        {
+            lock_guard<mutex> lock(g_mutex);
+            if (g_accepted.size() == (size_t)count) {
+                break ;
+            }
+        }
+        usleep(1000);
+    }
+    lock_guard<mutex> lock(g_mutex);
+    CHECK(g_accepted.size() == (size_t)count);
+    for (auto& item : g_accepted) {
+        CHECK(item.first >= 0 && item.first == item.second);
+    }
+    for (auto fd : fds) {
+        close(fd);
+    }
+    engine->terminate();
+}
+
+int main()
+{
+    test_reuseport_local();
+    printf("test_server ok\n");
+    return 0;
+}
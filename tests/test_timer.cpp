@@ -0,0 +1,307 @@
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "timer.h"
+#include "timer_executor.h"
+#include "epoll_engine/epoll_timer_executor.h"
+#include "test_check.h"
+
+using namespace std;
+
+// 等待cond成立，最多timeout_ms
+template <class F>
+static bool wait_for(F cond, int timeout_ms)
+{
+    for (int i = 0; i < timeout_ms && !cond(); i++) {
+        usleep(1000);
+    }
+    return cond();
+}
+
+static void test_oneshot()
+{
+    Timer timer(1, 2);
+    timer.init(1);
+    atomic<int> fired(0);
+    auto id = timer.set(5, [&]() {fired++;});
+    CHECK(timer.size() == 1);
+    // 回调返回后才置为FINISH
+    CHECK(wait_for([&] {return timer.get_state(id) == TIMER_FINISH;}, 1000));
+    CHECK(fired.load() == 1);
+    CHECK(timer.cancel(id) == TIMER_ERROR_TIMER_CANT_CANCEL);
+    CHECK(timer.empty());
+
+    atomic<int> cancelled(0);
+    auto id2 = timer.set(20, [&]() {cancelled++;});
+    CHECK(timer.cancel(id2) == 0);
+    CHECK(timer.cancel(id2) == TIMER_ERROR_TIMER_ALREADY_CANCEL);
+    CHECK(timer.get_state(id2) == TIMER_CANCEL);
+    usleep(50000);
+    CHECK(cancelled.load() == 0);
+    CHECK(timer.empty());
+}
+
+// 多线程同时set/cancel，落在不同分片；被取消的一个都不触发，其余各触发一次
+static void test_cancel_threads()
+{
+    const int thread_count = 4;
+    const int count = 5000;
+    Timer timer(1, 4);
+    timer.init(2);
+    vector<atomic<int>> fired(thread_count * count);
+    vector<thread> threads;
+    for (int t = 0; t < thread_count; t++) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < count; i++) {
+                auto index = t * count + i;
+                auto id = timer.set(10 + i % 30, [&fired, index]() {fired[index]++;});
+                if (i % 2) {
+                    CHECK(timer.cancel(id) == 0);
+                }
+            }
+        });
+    }
+    for (auto& item : threads) {
+        item.join();
+    }
+    CHECK(wait_for([&] {return timer.empty();}, 2000));
+    usleep(20000);
+    for (int i = 0; i < thread_count * count; i++) {
+        CHECK(fired[i].load() == (i % count % 2 ? 0 : 1));
+    }
+}
+
+// 周期定时器在到期线程上执行：回调内取消自身后不再触发
+static void test_periodic_self_cancel()
+{
+    Timer timer(1, 2);
+    timer.init(1);
+    atomic<int> count(0);
+    unique_ptr<TimerId> id;
+    atomic<bool> ready(false);
+    atomic<bool> cancelled(false);
+    id.reset(new TimerId(timer.set_periodic(2, [&]() {
+        while (!ready.load()) {
+            usleep(100);
+        }
+        if (++count == 3) {
+            CHECK(timer.cancel(*id) == 0);
+            cancelled = true;
+        }
+    })));
+    ready = true;
+    CHECK(wait_for([&] {return cancelled.load();}, 1000));
+    usleep(30000);
+    CHECK(count.load() == 3);
+    CHECK(timer.empty());
+}
+
+// 回调在线程池执行时从其他线程取消，与完成后重新入轮竞争：
+// cancel成功后最多还有一次已交付的回调执行，之后不再触发，分片计数归零
+static void test_periodic_cancel_rearm()
+{
+    const int count = 200;
+    auto pool = make_shared<TimerPoolExecutor>(4);
+    Timer timer(1, 2);
+    timer.init(2, pool);
+    vector<atomic<int>> fired(count);
+    vector<unique_ptr<TimerId>> ids;
+    for (int i = 0; i < count; i++) {
+        auto mode = i % 2 ? TIMER_FIXED_DELAY : TIMER_FIXED_RATE;
+        ids.emplace_back(new TimerId(timer.set_periodic(1, [&fired, i]() {
+            fired[i]++;
+            usleep(i % 3 * 500);
+        }, mode)));
+    }
+    CHECK(wait_for([&] {
+        for (auto& item : fired) {
+            if (item.load() < 2) {
+                return false;
+            }
+        }
+        return true;
+    }, 2000));
+
+    vector<int> at_cancel(count);
+    vector<thread> threads;
+    for (int t = 0; t < 2; t++) {
+        threads.emplace_back([&, t]() {
+            for (int i = t; i < count; i += 2) {
+                at_cancel[i] = fired[i].load();
+                CHECK(timer.cancel(*ids[i]) == 0);
+                usleep(200);
+            }
+        });
+    }
+    for (auto& item : threads) {
+        item.join();
+    }
+    CHECK(timer.empty());
+    usleep(50000);
+    for (int i = 0; i < count; i++) {
+        auto value = fired[i].load();
+        CHECK(value >= at_cancel[i] && value <= at_cancel[i] + 1);
+    }
+    usleep(20000);
+    for (int i = 0; i < count; i++) {
+        CHECK(fired[i].load() <= at_cancel[i] + 1);
+        auto ret = timer.cancel(*ids[i]);
+        CHECK(ret == TIMER_ERROR_TIMER_ALREADY_CANCEL || ret == TIMER_ERROR_TIMERID_NOT_FOUND);
+    }
+
+    // 槽位回收后可复用
+    atomic<int> again(0);
+    for (int i = 0; i < count; i++) {
+        timer.set(1, [&]() {again++;});
+    }
+    CHECK(wait_for([&] {return again.load() == count;}, 1000));
+    CHECK(timer.empty());
+}
+
+// 单线程线程池每次取走全部积压，批次大于1时不越界
+static void test_pool_single_thread()
+{
+    const int count = 1000;
+    auto pool = make_shared<TimerPoolExecutor>(1);
+    Timer timer(1, 2);
+    timer.init(1, pool);
+    atomic<int> fired(0);
+    for (int i = 0; i < count; i++) {
+        timer.set(1 + i % 5, [&]() {fired++;});
+    }
+    CHECK(wait_for([&] {return fired.load() == count;}, 2000));
+    CHECK(timer.empty());
+}
+
+// 整批丢弃的执行器
+class DropExecutor : public TimerExecutor
+{
+public:
+    void execute(std::vector<TimerTask>& batch) override {
+        for (auto& task : batch) {
+            task.discard();
+        }
+    }
+};
+
+// 丢弃的一次性定时器置为TIMER_CANCEL，周期定时器被取消，均不执行，Timer析构不被挂起
+static void test_discard()
+{
+    atomic<int> fired(0);
+    Timer timer(1, 2);
+    timer.init(1, make_shared<DropExecutor>());
+    auto id = timer.set(1, [&]() {fired++;});
+    auto id2 = timer.set_periodic(1, [&]() {fired++;});
+    CHECK(wait_for([&] {return timer.get_state(id) == TIMER_CANCEL && timer.get_state(id2) == TIMER_CANCEL;}, 1000));
+    CHECK(timer.empty());
+    CHECK(timer.cancel(id2) == TIMER_ERROR_TIMER_ALREADY_CANCEL);
+    usleep(20000);
+    CHECK(fired.load() == 0);
+}
+
+// 延迟执行的执行器，任务在Timer析构开始后才运行
+class DelayExecutor : public TimerExecutor
+{
+public:
+    ~DelayExecutor() {
+        for (auto& item : _threads) {
+            item.join();
+        }
+    }
+
+    void execute(std::vector<TimerTask>& batch) override {
+        auto tasks = batch;
+        _threads.emplace_back([tasks]() {
+            usleep(50000);
+            for (auto& task : tasks) {
+                task();
+            }
+        });
+    }
+
+private:
+    vector<thread>  _threads;
+};
+
+// Timer析构等待已交付的回调执行完
+static void test_destructor_wait()
+{
+    auto executor = make_shared<DelayExecutor>();
+    atomic<int> fired(0);
+    {
+        Timer timer(1, 1);
+        timer.init(1, executor);
+        timer.set(1, [&]() {fired++;});
+        timer.set_periodic(1, [&]() {fired++;});
+        usleep(10000);
+        CHECK(fired.load() == 0);
+    }
+    CHECK(fired.load() >= 2);
+}
+
+// 引擎已终止时EpollTimerExecutor丢弃并计数，不在到期线程执行回调
+static void test_epoll_executor_drop()
+{
+    auto engine = make_shared<EpollEngine>(1, 16);
+    engine->terminate();
+    auto executor = make_shared<EpollTimerExecutor>(engine, 0);
+    atomic<int> fired(0);
+    {
+        Timer timer(1, 1);
+        timer.init(1, executor);
+        for (int i = 0; i < 10; i++) {
+            timer.set(1, [&]() {fired++;});
+        }
+        CHECK(wait_for([&] {return executor->get_dropped() == 10;}, 1000));
+        CHECK(timer.empty());
+    }
+    CHECK(fired.load() == 0);
+}
+
+// 到期批次在loop队列中积压时终止引擎：已投递的批次在loop退出前执行，Timer析构不被挂起
+static void test_epoll_executor_shutdown()
+{
+    auto engine = make_shared<EpollEngine>(1, 16);
+    auto executor = make_shared<EpollTimerExecutor>(engine, 0);
+    atomic<bool> release(false);
+    CHECK(engine->post(0, [&]() {
+        while (!release.load()) {
+            usleep(100);
+        }
+    }));
+    atomic<int> fired(0);
+    {
+        Timer timer(1, 1);
+        timer.init(1, executor);
+        for (int i = 0; i < 10; i++) {
+            timer.set(i, [&]() {fired++;});
+        }
+        CHECK(wait_for([&] {return timer.empty();}, 1000));
+        thread stopper([&]() {
+            engine->terminate();
+        });
+        usleep(10000);
+        release = true;
+        stopper.join();
+    }
+    CHECK(fired.load() + (int)executor->get_dropped() == 10);
+}
+
+int main()
+{
+    test_oneshot();
+    test_cancel_threads();
+    test_periodic_self_cancel();
+    test_periodic_cancel_rearm();
+    test_pool_single_thread();
+    test_discard();
+    test_destructor_wait();
+    test_epoll_executor_drop();
+    test_epoll_executor_shutdown();
+    printf("test_timer ok\n");
+    return 0;
+}
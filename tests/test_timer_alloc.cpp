@@ -0,0 +1,82 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <new>
+
+#include "timer.h"
+#include "test_check.h"
+
+using namespace std;
+
+// 统计全部线程的operator new次数，验证稳定运行后set/cancel不分配内存
+static atomic<long> g_allocs(0);
+
+void* operator new(size_t size)
+{
+    g_allocs++;
+    auto ptr = malloc(size > 0 ? size : 1);
+    if (!ptr) {
+        throw bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+// 恰好48字节的捕获
+struct Capture48
+{
+    atomic<long>* sum;
+    long values[5];
+};
+
+const int ROUND_SIZE = 512;
+
+// 每轮set后立即cancel，ROUND_SIZE对set和cancel正好攒满DRAIN_BATCH唤醒到期线程回收槽位
+template <class F>
+static long run_rounds(Timer& timer, int rounds, F func)
+{
+    auto before = g_allocs.load();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < ROUND_SIZE; i++) {
+            auto id = timer.set(60000, func);
+            CHECK(timer.cancel(id) == 0);
+        }
+        usleep(2000);
+    }
+    return g_allocs.load() - before;
+}
+
+int main()
+{
+    Timer timer(1, 1);
+    timer.init(1);
+    atomic<long> sum(0);
+    Capture48 capture = {&sum, {1, 2, 3, 4, 5}};
+    auto small = [capture]() {*capture.sum += capture.values[0];};
+    static_assert(sizeof(small) == 48, "capture is not 48 bytes");
+
+    // 预热：slab扩容、到期线程的vector等一次性分配
+    run_rounds(timer, 20, small);
+    auto allocs = run_rounds(timer, 100, small);
+    printf("allocs in %d set/cancel: %ld\n", 100 * ROUND_SIZE, allocs);
+    CHECK(allocs == 0);
+
+    // 超过48字节的捕获在堆上存放，确认计数有效
+    char big[64] = {0};
+    auto large = [&sum, big]() {sum += big[0];};
+    static_assert(sizeof(large) > 48, "capture fits inline");
+    CHECK(run_rounds(timer, 1, large) >= ROUND_SIZE);
+    CHECK(sum.load() == 0);
+    printf("test_timer_alloc ok\n");
+    return 0;
+}
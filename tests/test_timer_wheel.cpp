@@ -0,0 +1,92 @@
+#include <stdlib.h>
+
+#include <map>
+#include <vector>
+
+#include "epoll_engine/epoll_timer_wheel.h"
+#include "test_check.h"
+
+using namespace std;
+
+// 与逐个比较的结果对照：随机增删、推进后next_tick总是最早的到期tick，跨圈的定时器不提前触发
+static void test_next_tick()
+{
+    const uint32_t slots = 200;
+    EpollTimerWheel wheel(1, slots);
+    uint64_t now = 1000;
+    wheel.reset(now);
+    map<EpollTimerId, uint64_t> alive;
+    srand(7);
+    for (int round = 0; round < 3000; round++) {
+        auto op = rand() % 10;
+        if (op < 5) {
+            auto delay = (uint64_t)(rand() % (slots * 3));
+            auto id = wheel.add(now, delay, 0, []() {});
+            alive[id] = wheel.expire_tick(id);
+        } else if (op < 7 && !alive.empty()) {
+            auto it = alive.begin();
+            advance(it, rand() % alive.size());
+            CHECK(wheel.cancel(it->first));
+            alive.erase(it);
+        } else {
+            now += rand() % 50;
+            wheel.advance(now);
+            for (auto it = alive.begin(); it != alive.end();) {
+                if (it->second <= now) {
+                    CHECK(wheel.expire_tick(it->first) == 0);
+                    it = alive.erase(it);
+                } else {
+                    CHECK(wheel.expire_tick(it->first) == it->second);
+                    ++it;
+                }
+            }
+        }
+        uint64_t expect = 0;
+        for (auto& item : alive) {
+            if (expect == 0 || item.second < expect) {
+                expect = item.second;
+            }
+        }
+        CHECK(wheel.size() == alive.size());
+        CHECK(wheel.next_tick() == expect);
+        CHECK(wheel.next_tick() == expect);
+    }
+}
+
+// 周期定时器按上次到期点累加：推进滞后时不漂移，落后多个周期时跳过错过的周期只执行一次
+static void test_periodic_no_drift()
+{
+    EpollTimerWheel wheel(1, 64);
+    uint64_t now = 0;
+    wheel.reset(now);
+    int count = 0;
+    auto id = wheel.add(now, 10, 10, [&]() {count++;});
+    CHECK(wheel.expire_tick(id) == 10);
+    wheel.advance(13);
+    CHECK(count == 1);
+    CHECK(wheel.expire_tick(id) == 20);
+    CHECK(wheel.next_tick() == 20);
+    wheel.advance(27);
+    CHECK(count == 2);
+    CHECK(wheel.expire_tick(id) == 30);
+    // 错过40、50、60
+    wheel.advance(65);
+    CHECK(count == 3);
+    CHECK(wheel.expire_tick(id) == 70);
+    CHECK(wheel.next_tick() == 70);
+    // 跨越超过一圈
+    wheel.advance(70 + 64 * 3 + 5);
+    CHECK(count == 4);
+    CHECK(wheel.expire_tick(id) == 270);
+    CHECK(wheel.cancel(id));
+    CHECK(wheel.empty());
+    CHECK(wheel.next_tick() == 0);
+}
+
+int main()
+{
+    test_next_tick();
+    test_periodic_no_drift();
+    printf("test_timer_wheel ok\n");
+    return 0;
+}
@@ -1,19 +1,25 @@
 #ifndef __TIMER_H__
 #define __TIMER_H__
 
+#include <stdio.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/prctl.h>
 
-#include <map>
-#include <unordered_map>
 #include <vector>
 
 #include <atomic>
+#include <memory>
 #include <mutex>
 #include <thread>
-#include <condition_variable>
 #include <functional>
+#include <stdexcept>
 
 #include "any.h"
+#include "common_utils.h"
+#include "futex_waiter.h"
+#include "inline_function.h"
+#include "timer_wheel.h"
 
 enum TimerState
 {
@@ -30,15 +36,37 @@ const int TIMER_ERROR_TIMERID_NOT_FOUND = 2;
 const int TIMER_ERROR_TIMER_CANT_CANCEL = 3;
 const int TIMER_ERROR_TIMER_ALREADY_CANCEL = 4;
 
+enum TimerPeriodMode
+{
+	TIMER_FIXED_RATE,		// 按首次到期时间等间隔触发，落后时连续补执行
+	TIMER_FIXED_DELAY,		// 上次回调返回后间隔interval再触发
+};
+
 class Timer;
 
-struct TimerInfo
+typedef InlineFunction<void()> TimerFunc;
+
+// 定时器槽位，由所属分片的slab分配并循环使用，地址在Timer生命期内不变。
+// state高32位为代数，每次分配加一，低32位为TimerState；待插入链表复用TimerNode::next串联
+struct TimerInfo : public TimerNode
 {
-	long				active_time;
-	atomic<int>			state;
-	function<void()>	func;
+	atomic<uint64_t>	state = {(uint64_t)(uint32_t)TIMER_UNKNOW};
+	atomic<long>		active_time = {0};	// 单调时钟微秒
+	atomic<long>		interval = {0};		// 微秒，大于0为周期定时器
+	TimerPeriodMode		mode = TIMER_FIXED_RATE;
+	TimerFunc			func;
+	uint32_t			shard = 0;
+	uint32_t			index = 0;
+	atomic<uint32_t>	free_next = {0};
+	TimerInfo*			cancel_next = NULL;
+	TimerInfo*			done_next = NULL;
+	// 以下仅由所属到期线程访问：周期定时器交给执行器后置inflight，
+	// 期间被取消的由回调完成后回收，避免在回调执行中释放槽位
+	bool				inflight = false;
+	bool				cancel_seen = false;
 };
 
+// 槽位指针加代数，槽位被复用后旧id自动失效
 class TimerId
 {
 friend class Timer;
@@ -47,150 +75,643 @@ public:
 	TimerId& operator=(const TimerId& id) = delete;
 
 protected:
-	TimerId(shared_ptr<TimerInfo> ptr) {
+	TimerId(TimerInfo* ptr, uint32_t gen) {
 		_ptr = ptr;
+		_gen = gen;
 	}
 
-	std::shared_ptr<TimerInfo> _ptr;
+	TimerInfo*	_ptr;
+	uint32_t	_gen;
 };
 
-class Timer
+// 一个到期回调，执行器须对每个任务调用且只调用一次operator()或discard()，可在任意线程执行
+class TimerTask
+{
+friend class Timer;
+public:
+	void operator()() const;
+
+	// 执行器无法执行时代替operator()调用，回调不执行：一次性定时器置为TIMER_CANCEL，周期定时器被取消
+	void discard() const;
+
+private:
+	TimerTask(Timer* timer, TimerInfo* ptr, uint32_t gen) {
+		_timer = timer;
+		_ptr = ptr;
+		_gen = gen;
+	}
+
+	Timer*		_timer;
+	TimerInfo*	_ptr;
+	uint32_t	_gen;
+};
+
+// 回调执行器，到期线程每轮将到期回调打包为一批交给execute，执行器可移走batch中的任务。
+// 已交付的任务须在Timer析构前执行或丢弃，Timer析构时等待
+class TimerExecutor
 {
 public:
-	typedef std::multimap<long, std::shared_ptr<TimerInfo>>	timer_list_t;
-	typedef std::unordered_map<std::shared_ptr<TimerInfo>, timer_list_t::iterator>	map_timer_list_t;
+	virtual ~TimerExecutor() {}
+
+	virtual void execute(std::vector<TimerTask>& batch) = 0;
+};
 
-	Timer() {
+// 分片定时器：每个分片有独立的分层时间轮，由唯一的到期线程独占，时间轮本身不加锁。
+// set按调用线程选择分片，以CAS压入分片的无锁待插入链表，只有新定时器早于该分片
+// 已公布的最近到期点时才唤醒到期线程。cancel做状态CAS后压入分片的取消链表，
+// 由到期线程下次处理分片时从时间轮摘除回收，积压达到DRAIN_BATCH时提前唤醒。
+// TimerInfo取自分片的slab，回调不超过48字节时内联存放，稳定运行后set/cancel不分配内存。
+// 回调默认在到期线程执行，也可由init传入的执行器执行，到期线程只做到期检测，周期定时器
+// 回调完成后经分片的完成链表交回到期线程重新入轮。
+// 时间基准为CLOCK_MONOTONIC微秒，不受校时影响；到期线程按绝对时间睡眠，可选到期前自旋。
+// tick_ms为时间轮精度，到期时间向上取整到tick，亚毫秒精度由set_resolution设置；shard_count为0时取cpu数
+class Timer
+{
+public:
+	Timer(size_t tick_ms = 1, size_t shard_count = 0) {
 		_is_init = false;
 		_is_set_end = false;
+		_tick_us = tick_ms > 0 ? (long)tick_ms * 1000 : 1000;
+		_spin_us = 0;
+		if (shard_count == 0) {
+			shard_count = thread::hardware_concurrency();
+		}
+		shard_count = shard_count > 0 ? shard_count : 1;
+		for (size_t i = 0; i < shard_count; i++) {
+			_shards.emplace_back(new Shard);
+			_shards.back()->id = (uint32_t)i;
+		}
+		reset_wheels();
 	}
 
     ~Timer() {
-		_is_set_end = true;	
-		_cv.notify_all();
+		_is_set_end = true;
+		for (auto& item : _waiters) {
+			item->notify(true);
+		}
 		for (auto& item : _threads) {
 			item.join();
 		}
+		// 等待已交给执行器的回调完成：置等待位后睡在计数上，由最后一个回调唤醒
+		auto running = _running.fetch_or(RUNNING_WAIT) | RUNNING_WAIT;
+		while (running != RUNNING_WAIT) {
+			syscall(SYS_futex, &_running, FUTEX_WAIT_PRIVATE, running, NULL, NULL, 0);
+			running = _running.load();
+		}
+		// 时间轮中只有指向槽位的指针，槽位随slab一并释放
+		for (auto& shard : _shards) {
+			auto count = shard->chunk_count.load();
+			for (uint32_t i = 0; i < count; i++) {
+				delete[] shard->chunks[i].load();
+			}
+		}
 	}
 
-	void init(size_t thread_num) {
+	// 启动thread_num个到期线程，各自负责互不相交的分片，多于分片数的线程不会启动；
+	// executor为空时回调在到期线程执行
+	void init(size_t thread_num, std::shared_ptr<TimerExecutor> executor = NULL) {
 		std::lock_guard<std::mutex> lock(_mutex);
 		if (!_is_init) {
 			_is_init = true;
+			_executor = executor;
+			if (thread_num > _shards.size()) {
+				thread_num = _shards.size();
+			}
+			for (int i = 0; i < (int)thread_num; i++) {
+				_waiters.emplace_back(new FutexWaiter);
+			}
+			for (size_t i = 0; i < _shards.size() && thread_num > 0; i++) {
+				_shards[i]->waiter.store(_waiters[i % thread_num].get(), memory_order_release);
+			}
 			for (int i = 0; i < (int)thread_num; i++) {
-				_threads.emplace_back([this]() {
-					run();
+				_threads.emplace_back([this, i, thread_num]() {
+					run(i, thread_num);
 				});
 			}
 		}
 		return ;
 	}
 
-	TimerId set(size_t delay_ms, const std::function<void()>& func) {
-		auto ptr = std::shared_ptr<TimerInfo>(new TimerInfo);
-		ptr->active_time = now_ms() + (long)delay_ms;
-		ptr->func = func;
-		ptr->state.store((int)TIMER_WAIT);
-		{
-			std::lock_guard<std::mutex> lock(_mutex);
-			_map_list_iter[ptr] = _list.insert(make_pair(ptr->active_time, ptr));
-			TimerId ti(ptr);
+	// 时间轮精度改为tick_us微秒；spin_us > 0时到期前该时长内忙等而不睡眠，换取数微秒内的触发精度，
+	// 代价是到期线程在窗口内占满一个核。须在init与任何set之前调用，否则返回false
+	bool set_resolution(size_t tick_us, size_t spin_us = 0) {
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_is_init || size() > 0) {
+			return false;
 		}
-		_cv.notify_one();
-		return ti;
+		_tick_us = tick_us > 0 ? (long)tick_us : 1;
+		_spin_us = (long)spin_us;
+		reset_wheels();
+		return true;
+	}
+
+	// func可为任意可调用对象，不超过48字节时不分配内存
+	template <class F>
+	TimerId set(size_t delay_ms, F&& func) {
+		return add((long)delay_ms * 1000, 0, TIMER_FIXED_RATE, std::forward<F>(func));
+	}
+
+	template <class F>
+	TimerId set_us(size_t delay_us, F&& func) {
+		return add((long)delay_us, 0, TIMER_FIXED_RATE, std::forward<F>(func));
+	}
+
+	// 周期定时器，首次在interval_ms后触发，直到cancel；回调执行期间也可取消
+	template <class F>
+	TimerId set_periodic(size_t interval_ms, F&& func, TimerPeriodMode mode = TIMER_FIXED_RATE) {
+		return set_periodic_us(interval_ms * 1000, std::forward<F>(func), mode);
+	}
+
+	template <class F>
+	TimerId set_periodic_us(size_t interval_us, F&& func, TimerPeriodMode mode = TIMER_FIXED_RATE) {
+		auto interval = interval_us > 0 ? (long)interval_us : 1;
+		return add(interval, interval, mode, std::forward<F>(func));
 	}
 
+	// 无锁取消：状态由WAIT转为CANCEL即成功，节点由到期线程摘除回收；
+	// 槽位已被复用时返回TIMER_ERROR_TIMERID_NOT_FOUND
     int cancel(const TimerId& id) {
 		if (!id._ptr) {
 			return TIMER_ERROR_TIMERID_INVALID;
 		}
-		auto state = (TimerState)(id._ptr->state.load());
-		if (state == TIMER_PROCESS || state == TIMER_FINISH) {
-			return TIMER_ERROR_TIMER_CANT_CANCEL;
-		}
-		if (state == TIMER_CANCEL) {
-			return TIMER_ERROR_TIMER_ALREADY_CANCEL;
-		}
-		lock_guard<mutex> lock(_mutex);
-		auto iter = _map_list_iter.find(id._ptr);
-		if (iter == _map_list_iter.end()) {
-			return TIMER_ERROR_TIMERID_NOT_FOUND;
+		auto word = id._ptr->state.load();
+		while (1) {
+			if ((uint32_t)(word >> 32) != id._gen) {
+				return TIMER_ERROR_TIMERID_NOT_FOUND;
+			}
+			auto state = state_of(word);
+			auto periodic = id._ptr->interval.load(memory_order_relaxed) > 0;
+			if ((state == TIMER_PROCESS && !periodic) || state == TIMER_FINISH) {
+				return TIMER_ERROR_TIMER_CANT_CANCEL;
+			}
+			if (state == TIMER_CANCEL) {
+				return TIMER_ERROR_TIMER_ALREADY_CANCEL;
+			}
+			if (id._ptr->state.compare_exchange_weak(word, make_state(id._gen, TIMER_CANCEL))) {
+				break ;
+			}
 		}
-		id._ptr->state.store((int)TIMER_CANCEL);
-		_list.erase(iter->second);
-		_map_list_iter.erase(iter);
+		auto& shard = *_shards[id._ptr->shard];
+		shard.size.fetch_sub(1, memory_order_relaxed);
+		auto head = shard.cancel_inbox.load(memory_order_relaxed);
+		do {
+			id._ptr->cancel_next = head;
+		} while (!shard.cancel_inbox.compare_exchange_weak(head, id._ptr, memory_order_release, memory_order_relaxed));
+		add_pending(shard);
 		return 0;
 	}
 
+	// 槽位已被复用时返回TIMER_UNKNOW
 	TimerState get_state(const TimerId& id) {
 		if (!id._ptr) {
 			return TIMER_UNKNOW;
 		}
-		auto state = (TimerState)(id._ptr->state.load());
-		if (state == TIMER_WAIT && id._ptr->active_time <= now_ms()) {
+		auto word = id._ptr->state.load();
+		auto active_time = id._ptr->active_time.load(memory_order_relaxed);
+		if ((uint32_t)(word >> 32) != id._gen || id._ptr->state.load() != word) {
+			return TIMER_UNKNOW;
+		}
+		auto state = state_of(word);
+		if (state == TIMER_WAIT && active_time <= now_us()) {
 			state = TIMER_READY;
 		}
 		return state;
 	}
 
+	// 等待执行的定时器数，不含已取消的
 	int size() {
-		std::lock_guard<std::mutex> lock(_mutex);
-		return (int)_list.size();
+		int size = 0;
+		for (auto& shard : _shards) {
+			size += shard->size.load(memory_order_relaxed);
+		}
+		return size;
 	}
 
 	bool empty() {
-		std::lock_guard<std::mutex> lock(_mutex);
-		return _list.size() == 0 ? true : false;	
+		return size() == 0;
 	}
 
 private:
-	void run() {
+	template <class F>
+	TimerId add(long delay_us, long interval_us, TimerPeriodMode mode, F&& func) {
+		auto& shard = *_shards[local_shard()];
+		auto ptr = alloc_info(shard);
+		auto active_time = now_us() + delay_us;
+		auto expire_tick = to_tick(active_time);
+		ptr->active_time.store(active_time, memory_order_relaxed);
+		ptr->expire_tick = expire_tick;
+		ptr->interval.store(interval_us, memory_order_relaxed);
+		ptr->mode = mode;
+		ptr->func = std::forward<F>(func);
+		auto gen = (uint32_t)(ptr->state.load(memory_order_relaxed) >> 32) + 1;
+		ptr->state.store(make_state(gen, TIMER_WAIT));
+
+		shard.size.fetch_add(1, memory_order_relaxed);
+		auto head = shard.inbox.load(memory_order_relaxed);
+		do {
+			ptr->next = head;
+		} while (!shard.inbox.compare_exchange_weak(head, ptr, memory_order_seq_cst, memory_order_relaxed));
+
+		// 入队后槽位可能已被执行并复用，不再访问ptr
+		wake_if_earlier(shard, expire_tick);
+		add_pending(shard);
+		return TimerId(ptr, gen);
+	}
+
+	// 在执行器线程调用，一次性定时器直接回收，周期定时器计算下次到期时间后压入完成链表
+	void execute(TimerInfo* ptr, uint32_t gen) {
+		auto& shard = *_shards[ptr->shard];
+		auto interval = ptr->interval.load(memory_order_relaxed);
+		if (ptr->func) {
+			ptr->func();
+		}
+		if (interval == 0) {
+			ptr->state.store(make_state(gen, TIMER_FINISH));
+			free_info(shard, ptr);
+			finish_task();
+			return ;
+		}
+		// 固定频率以上次的预定时间为基准不累积漂移，落后时新的到期点已过，下一轮立即补执行
+		long active_time;
+		if (ptr->mode == TIMER_FIXED_RATE) {
+			active_time = ptr->active_time.load(memory_order_relaxed) + interval;
+		} else {
+			active_time = now_us() + interval;
+		}
+		ptr->active_time.store(active_time, memory_order_relaxed);
+		push_done(shard, ptr);
+		wake_if_earlier(shard, to_tick(active_time));
+		finish_task();
+	}
+
+	// 在执行器线程调用，与取消竞争时按取消处理：周期定时器经取消链表与完成链表由到期线程回收
+	void discard(TimerInfo* ptr, uint32_t gen) {
+		auto& shard = *_shards[ptr->shard];
+		if (ptr->interval.load(memory_order_relaxed) == 0) {
+			ptr->state.store(make_state(gen, TIMER_CANCEL));
+			free_info(shard, ptr);
+		} else {
+			cancel(TimerId(ptr, gen));
+			push_done(shard, ptr);
+		}
+		finish_task();
+	}
+
+	// 每个已交付的任务结束时调用，须是该任务对Timer的最后一次访问。
+	// 析构方在等待时由最后一个任务唤醒，此后只把计数地址交给内核，析构方已返回也不会读写已释放的内存
+	void finish_task() {
+		if (_running.fetch_sub(1) == (RUNNING_WAIT | 1)) {
+			syscall(SYS_futex, &_running, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+		}
+	}
+
+	enum {
+		CACHE_LINE = 64,
+		CHUNK_SIZE = 1024,			// slab每次扩容的槽位数
+		MAX_CHUNKS = 4096,
+		DRAIN_BATCH = 1024,			// 待处理的插入与取消积压到该数量时唤醒到期线程
+	};
+
+	static const uint32_t NIL = 0xffffffff;
+	static const uint32_t RUNNING_WAIT = 0x80000000;	// _running的最高位，析构方正在等待
+
+	friend class TimerTask;
+
+	struct alignas(CACHE_LINE) Shard
+	{
+		atomic<TimerNode*>		inbox = {NULL};
+		atomic<TimerInfo*>		cancel_inbox = {NULL};
+		atomic<TimerInfo*>		done_inbox = {NULL};
+		atomic<uint32_t>		pending = {0};
+		// 到期线程公布的最近到期tick，生产者只会将其调小
+		atomic<uint64_t>		next_tick = {(uint64_t)TimerWheel::NO_EVENT};
+		atomic<FutexWaiter*>	waiter = {NULL};
+		atomic<int>				size = {0};
+		uint32_t				id = 0;
+
+		// 空闲槽位栈，高32位为防ABA的版本号，低32位为槽位下标
+		alignas(CACHE_LINE) atomic<uint64_t>	free_head = {NIL};
+		mutex					grow_mutex;
+		atomic<uint32_t>		chunk_count = {0};
+		atomic<TimerInfo*>		chunks[MAX_CHUNKS] = {};
+
+		// 以下仅由所属到期线程访问
+		alignas(CACHE_LINE) TimerWheel	wheel;
+	};
+
+	static long now_us() {
+		return CommonUtils::monotonic_us();
+	}
+
+	uint64_t to_tick(long time_us) {
+		return (uint64_t)((time_us + _tick_us - 1) / _tick_us);
+	}
+
+	void reset_wheels() {
+		auto now_tick = (uint64_t)(now_us() / _tick_us);
+		for (auto& shard : _shards) {
+			shard->wheel.reset(now_tick);
+		}
+	}
+
+	static uint64_t make_state(uint32_t gen, TimerState state) {
+		return ((uint64_t)gen << 32) | (uint32_t)state;
+	}
+
+	static TimerState state_of(uint64_t word) {
+		return (TimerState)(int32_t)(uint32_t)word;
+	}
+
+	uint32_t local_shard() {
+		static thread_local uint32_t tid = (uint32_t)CommonUtils::gettid();
+		return tid % _shards.size();
+	}
+
+	static void notify(Shard& shard) {
+		auto waiter = shard.waiter.load(memory_order_acquire);
+		if (waiter) {
+			waiter->notify();
+		}
+	}
+
+	// 只有早于分片当前最近到期点时才降低它并唤醒，0表示到期线程正在处理该分片
+	static void wake_if_earlier(Shard& shard, uint64_t expire_tick) {
+		auto next = shard.next_tick.load(memory_order_seq_cst);
+		while (expire_tick < next) {
+			if (shard.next_tick.compare_exchange_weak(next, expire_tick, memory_order_seq_cst)) {
+				notify(shard);
+				break ;
+			}
+		}
+	}
+
+	// 周期定时器回调结束后交回到期线程
+	static void push_done(Shard& shard, TimerInfo* ptr) {
+		auto head = shard.done_inbox.load(memory_order_relaxed);
+		do {
+			ptr->done_next = head;
+		} while (!shard.done_inbox.compare_exchange_weak(head, ptr, memory_order_seq_cst, memory_order_relaxed));
+	}
+
+	static void add_pending(Shard& shard) {
+		if (shard.pending.fetch_add(1, memory_order_relaxed) + 1 == DRAIN_BATCH) {
+			notify(shard);
+		}
+	}
+
+	static TimerInfo* slot(Shard& shard, uint32_t index) {
+		return shard.chunks[index / CHUNK_SIZE].load(memory_order_acquire) + index % CHUNK_SIZE;
+	}
+
+	TimerInfo* alloc_info(Shard& shard) {
+		auto head = shard.free_head.load(memory_order_acquire);
+		while (1) {
+			auto index = (uint32_t)head;
+			if (index == NIL) {
+				grow(shard);
+				head = shard.free_head.load(memory_order_acquire);
+				continue ;
+			}
+			auto ptr = slot(shard, index);
+			auto next = ptr->free_next.load(memory_order_relaxed);
+			auto new_head = (((head >> 32) + 1) << 32) | next;
+			if (shard.free_head.compare_exchange_weak(head, new_head, memory_order_acquire, memory_order_acquire)) {
+				return ptr;
+			}
+		}
+	}
+
+	// 由到期线程或执行器回收，代数在下次分配时递增，此前旧id仍可查询到最终状态
+	void free_info(Shard& shard, TimerInfo* ptr) {
+		ptr->func = nullptr;
+		push_free(shard, ptr, ptr);
+	}
+
+	// 将first到last之间已由free_next串好的槽位压入空闲栈
+	void push_free(Shard& shard, TimerInfo* first, TimerInfo* last) {
+		auto head = shard.free_head.load(memory_order_relaxed);
+		uint64_t new_head;
+		do {
+			last->free_next.store((uint32_t)head, memory_order_relaxed);
+			new_head = (((head >> 32) + 1) << 32) | first->index;
+		} while (!shard.free_head.compare_exchange_weak(head, new_head, memory_order_release, memory_order_relaxed));
+	}
+
+	// 空闲槽位耗尽时追加一块，已分配的块在Timer析构前不释放
+	void grow(Shard& shard) {
+		std::lock_guard<std::mutex> lock(shard.grow_mutex);
+		if ((uint32_t)shard.free_head.load(memory_order_acquire) != NIL) {
+			return ;
+		}
+		auto count = shard.chunk_count.load(memory_order_relaxed);
+		if (count == MAX_CHUNKS) {
+			throw runtime_error("timer slab full");
+		}
+		auto chunk = new TimerInfo[CHUNK_SIZE];
+		for (uint32_t i = 0; i < CHUNK_SIZE; i++) {
+			chunk[i].shard = shard.id;
+			chunk[i].index = count * CHUNK_SIZE + i;
+			chunk[i].free_next.store(chunk[i].index + 1, memory_order_relaxed);
+		}
+		shard.chunks[count].store(chunk, memory_order_release);
+		shard.chunk_count.store(count + 1, memory_order_release);
+		push_free(shard, &chunk[0], &chunk[CHUNK_SIZE - 1]);
+	}
+
+	// 已取消的槽位由取消链表回收，回调执行中被取消的周期定时器推迟到完成链表回收。
+	// 先取取消链表再取待插入链表，保证取消链表中的节点已移出待插入链表：
+	// 在时间轮中则摘除，否则已到期或未入轮
+	void drain(Shard& shard) {
+		auto cancelled = shard.cancel_inbox.exchange(NULL, memory_order_acquire);
+		shard.pending.store(0, memory_order_relaxed);
+		auto node = shard.inbox.exchange(NULL, memory_order_seq_cst);
+		while (node) {
+			auto ptr = (TimerInfo*)node;
+			node = node->next;
+			ptr->next = NULL;
+			if (state_of(ptr->state.load()) != TIMER_CANCEL) {
+				shard.wheel.add(ptr);
+			}
+		}
+		while (cancelled) {
+			auto ptr = cancelled;
+			cancelled = cancelled->cancel_next;
+			shard.wheel.remove(ptr);
+			if (ptr->inflight) {
+				ptr->cancel_seen = true;
+				continue ;
+			}
+			free_info(shard, ptr);
+		}
+		auto done = shard.done_inbox.exchange(NULL, memory_order_seq_cst);
+		while (done) {
+			auto ptr = done;
+			done = done->done_next;
+			rearm(shard, ptr);
+		}
+	}
+
+	// 周期定时器回调完成后重新入轮；期间被取消的若取消链表已处理过则在此回收，否则留给取消链表
+	void rearm(Shard& shard, TimerInfo* ptr) {
+		ptr->inflight = false;
+		auto word = ptr->state.load();
+		auto gen = (uint32_t)(word >> 32);
+		if (state_of(word) == TIMER_PROCESS
+			&& ptr->state.compare_exchange_strong(word, make_state(gen, TIMER_WAIT))) {
+			ptr->expire_tick = to_tick(ptr->active_time.load(memory_order_relaxed));
+			shard.wheel.add(ptr);
+			return ;
+		}
+		if (ptr->cancel_seen) {
+			ptr->cancel_seen = false;
+			free_info(shard, ptr);
+		}
+	}
+
+	// 处理分片并公布最近到期点；公布后若又有新插入则重新处理，保证不漏唤醒
+	uint64_t process(Shard& shard, std::vector<TimerInfo*>& expired_list) {
+		uint64_t next;
+		while (1) {
+			shard.next_tick.store(0, memory_order_seq_cst);
+			drain(shard);
+			TimerNode expired;
+			TimerWheel::init_head(&expired);
+			shard.wheel.advance((uint64_t)(now_us() / _tick_us), &expired);
+			while (expired.next != &expired) {
+				auto ptr = (TimerInfo*)expired.next;
+				TimerWheel::unlink(ptr);
+				if (state_of(ptr->state.load()) == TIMER_WAIT) {
+					expired_list.push_back(ptr);
+				}
+			}
+			next = shard.wheel.next_event();
+			shard.next_tick.store(next, memory_order_seq_cst);
+			if (!shard.inbox.load(memory_order_seq_cst) && !shard.done_inbox.load(memory_order_seq_cst)) {
+				break ;
+			}
+		}
+		return next;
+	}
+
+	void run(size_t index, size_t thread_num) {
+		std::vector<Shard*> owned;
+		for (size_t i = index; i < _shards.size(); i += thread_num) {
+			owned.push_back(_shards[i].get());
+		}
+		std::vector<uint64_t> planned(owned.size());
+		std::vector<TimerInfo*> expired_list;
+		std::vector<TimerTask> batch;
+		auto waiter = _waiters[index].get();
+		// 任一分片的最近到期点被生产者调小或积压过多即唤醒
+		auto ready = [&] {
+			if (_is_set_end) {
+				return true;
+			}
+			for (size_t i = 0; i < owned.size(); i++) {
+				if (owned[i]->next_tick.load(memory_order_seq_cst) < planned[i]
+					|| owned[i]->pending.load(memory_order_relaxed) >= DRAIN_BATCH) {
+					return true;
+				}
+			}
+			return false;
+		};
+		// 亚毫秒精度下将内核定时器松弛量从默认50us降到1ns，否则睡眠唤醒会整体推迟
+		if (_tick_us < 1000 || _spin_us > 0) {
+			prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+		}
 		while (!_is_set_end) {
-			int wait_ms = 0;
-			std::shared_ptr<TimerInfo> ptr;
-			{
-				std::lock_guard<std::mutex> lock(_mutex);
-				if (!_list.empty()) {
-					auto iter = _list.begin();	
-					auto delta = iter->first - now_ms();
-					if (delta <= 0) {
-						ptr = iter->second;
-						_map_list_iter.erase(iter->second);
-						_list.erase(iter);
+			auto wake_tick = (uint64_t)TimerWheel::NO_EVENT;
+			for (size_t i = 0; i < owned.size(); i++) {
+				planned[i] = process(*owned[i], expired_list);
+				if (planned[i] < wake_tick) {
+					wake_tick = planned[i];
+				}
+			}
+
+			// 到期定时器在所有分片处理完后作为一批交给执行器
+			if (!expired_list.empty()) {
+				for (auto ptr : expired_list) {
+					auto word = ptr->state.load();
+					auto gen = (uint32_t)(word >> 32);
+					if (state_of(word) != TIMER_WAIT
+						|| !ptr->state.compare_exchange_strong(word, make_state(gen, TIMER_PROCESS))) {
+						continue ;
+					}
+					if (ptr->interval.load(memory_order_relaxed) == 0) {
+						_shards[ptr->shard]->size.fetch_sub(1, memory_order_relaxed);
 					} else {
-						wait_ms = delta;
+						ptr->inflight = true;
 					}
+					batch.push_back(TimerTask(this, ptr, gen));
 				}
+				expired_list.clear();
+				dispatch(batch);
+				continue ;
 			}
-			if (ptr->func) {
-				ptr->_state.store(TIMER_PROCESS);
-				ptr->func();
-				ptr->_state.store(TIMER_FINISH);
+
+			if (wake_tick == (uint64_t)TimerWheel::NO_EVENT) {
+				waiter->wait(ready);
 				continue ;
 			}
-			std::unique_lock<std::mutex> lock(_mutex);
-			if (wait_ms == 0) {
-				_cv.wait(lock, [this] {
-					return !_list.empty() || _is_set_end;
-				});
-			} else {
-				_cv.wait_for(lock, chrono::milliseconds(wait_ms), [this] {
-					return !_list.empty() || _is_set_end;
-				});
+			auto wake_us = (long)wake_tick * _tick_us;
+			auto delta = wake_us - now_us();
+			if (delta <= 0) {
+				continue ;
+			}
+			// 进入自旋窗口后忙等到期，否则按绝对时间睡到窗口起点
+			if (delta <= _spin_us) {
+				while (!ready() && now_us() < wake_us) {
+					CommonUtils::cpu_relax();
+				}
+				continue ;
+			}
+			auto sleep_us = wake_us - _spin_us;
+			struct timespec deadline;
+			deadline.tv_sec = sleep_us / 1000000;
+			deadline.tv_nsec = sleep_us % 1000000 * 1000;
+			waiter->wait_until(ready, deadline);
+		}
+	}
+
+	void dispatch(std::vector<TimerTask>& batch) {
+		if (batch.empty()) {
+			return ;
+		}
+		_running.fetch_add((uint32_t)batch.size());
+		if (_executor) {
+			_executor->execute(batch);
+		} else {
+			for (auto& task : batch) {
+				task();
 			}
 		}
+		batch.clear();
 	}
 
 private:
-	timer_list_t		_list;
-	map_timer_list_t	_map_list_iter;
+	long	_tick_us;
+	long	_spin_us;
 
-	std::mutex	_mutex;
-	std::condition_variable		_cv;
+	std::vector<std::unique_ptr<Shard>>			_shards;
+	std::vector<std::unique_ptr<FutexWaiter>>	_waiters;
 	std::vector<std::thread>	_threads;
+	std::shared_ptr<TimerExecutor>	_executor;
+	// 已交付尚未执行完的回调数，最高位为RUNNING_WAIT
+	atomic<uint32_t>	_running = {0};
 
-	bool	_is_init;
-	bool	_is_set_end;
+	std::mutex	_mutex;
+	bool		_is_init;
+	atomic<bool>	_is_set_end;
 };
 
+inline void TimerTask::operator()() const
+{
+	_timer->execute(_ptr, _gen);
+}
+
+inline void TimerTask::discard() const
+{
+	_timer->discard(_ptr, _gen);
+}
+
 #endif
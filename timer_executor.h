@@ -0,0 +1,85 @@
+#ifndef __TIMER_EXECUTOR_H__
+#define __TIMER_EXECUTOR_H__
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include "timer.h"
+
+using namespace std;
+
+// 线程池执行器：一批到期回调一次加锁入队，工作线程每次取走平均份额，
+// 单个慢回调只推迟同一份额中排在它之后的回调。析构时执行完已入队的回调再退出
+class TimerPoolExecutor : public TimerExecutor
+{
+public:
+	explicit TimerPoolExecutor(size_t thread_num) {
+		_is_set_end = false;
+		_thread_num = thread_num > 0 ? thread_num : 1;
+		for (size_t i = 0; i < _thread_num; i++) {
+			_threads.emplace_back([this]() {
+				run();
+			});
+		}
+	}
+
+	~TimerPoolExecutor() {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_is_set_end = true;
+		}
+		_cv.notify_all();
+		for (auto& item : _threads) {
+			item.join();
+		}
+	}
+
+	void execute(std::vector<TimerTask>& batch) override {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_tasks.insert(_tasks.end(), batch.begin(), batch.end());
+		}
+		if (batch.size() > 1) {
+			_cv.notify_all();
+		} else {
+			_cv.notify_one();
+		}
+	}
+
+private:
+	void run() {
+		std::vector<TimerTask> local;
+		std::unique_lock<std::mutex> lock(_mutex);
+		while (1) {
+			_cv.wait(lock, [this] {return _is_set_end || !_tasks.empty();});
+			if (_tasks.empty()) {
+				break ;
+			}
+			// 每个线程取约1/_thread_num，至少1个且不超过剩余数量
+			auto count = std::min(_tasks.size(), (_tasks.size() + _thread_num - 1) / _thread_num);
+			local.insert(local.end(), _tasks.begin(), _tasks.begin() + count);
+			_tasks.erase(_tasks.begin(), _tasks.begin() + count);
+			lock.unlock();
+			for (auto& task : local) {
+				task();
+			}
+			local.clear();
+			lock.lock();
+		}
+	}
+
+private:
+	size_t	_thread_num;
+	std::vector<std::thread>	_threads;
+
+	std::mutex	_mutex;
+	std::condition_variable		_cv;
+	std::deque<TimerTask>		_tasks;
+	bool	_is_set_end;
+};
+
+#endif
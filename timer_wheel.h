@@ -0,0 +1,232 @@
+#ifndef __TIMER_WHEEL_H__
+#define __TIMER_WHEEL_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+// 时间轮侵入式链表节点，由定时器对象继承
+struct TimerNode
+{
+	TimerNode*	prev = NULL;
+	TimerNode*	next = NULL;
+	uint64_t	expire_tick = 0;
+
+	bool linked() {return next != NULL;}
+};
+
+// 分层时间轮：4层各256槽，第0层一槽一tick，上层一槽覆盖下层一圈，覆盖2^32个tick；
+// 更远的节点先挂在最高层，回落时重新计算位置。add/remove为O(1)，
+// 节点在到达下层边界时逐层回落。每层以位图记录非空槽，空闲时advance可直接跳到下一个事件点。
+// 非线程安全，由调用方加锁
+class TimerWheel
+{
+public:
+	enum {
+		LEVEL_BITS	= 8,
+		LEVEL_SLOTS	= 1 << LEVEL_BITS,
+		LEVEL_COUNT	= 4,
+		NO_EVENT	= -1,
+	};
+
+	TimerWheel() {
+		_cur_tick = 0;
+		_size = 0;
+		for (int i = 0; i < LEVEL_COUNT; i++) {
+			for (int j = 0; j < LEVEL_SLOTS; j++) {
+				init_head(&_slots[i][j]);
+			}
+			for (int j = 0; j < LEVEL_SLOTS / 64; j++) {
+				_bitmap[i][j] = 0;
+			}
+		}
+		init_head(&_due);
+	}
+
+	// 首次使用前以当前tick初始化
+	void reset(uint64_t tick) {
+		_cur_tick = tick;
+	}
+
+	// expire_tick不晚于当前tick的节点在下一次advance时立即到期
+	void add(TimerNode* node) {
+		_size++;
+		place(node);
+	}
+
+	void remove(TimerNode* node) {
+		if (!node->linked()) {
+			return ;
+		}
+		auto prev = node->prev;
+		unlink(node);
+		_size--;
+		// 槽位取空时清除位图，避免空闲时被无效唤醒
+		if (prev->next == prev) {
+			clear_bit(prev);
+		}
+	}
+
+	// 推进到tick，到期节点按到期顺序移入expired(调用方提供的空链表哨兵)
+	void advance(uint64_t tick, TimerNode* expired) {
+		move_all(&_due, expired);
+		while (_cur_tick < tick) {
+			auto next = next_event();
+			if (next == (uint64_t)NO_EVENT || next > tick) {
+				_cur_tick = tick;
+				break ;
+			}
+			_cur_tick = next;
+			cascade();
+			move_all(&_slots[0][_cur_tick & (LEVEL_SLOTS - 1)], expired);
+			move_all(&_due, expired);
+		}
+		for (auto node = expired->next; node != expired; node = node->next) {
+			_size--;
+		}
+	}
+
+	// 下一个需要处理的tick(到期或回落)，无节点时返回NO_EVENT
+	uint64_t next_event() {
+		if (_due.next != &_due) {
+			return _cur_tick;
+		}
+		if (_size == 0) {
+			return (uint64_t)NO_EVENT;
+		}
+		uint64_t next = (uint64_t)NO_EVENT;
+		for (int level = 0; level < LEVEL_COUNT; level++) {
+			auto shift = level * LEVEL_BITS;
+			auto base = _cur_tick >> shift;
+			auto start = (int)((base + 1) & (LEVEL_SLOTS - 1));
+			auto dist = find_slot(level, start);
+			if (dist < 0) {
+				continue ;
+			}
+			auto tick = (base + 1 + dist) << shift;
+			if (tick < next) {
+				next = tick;
+			}
+		}
+		return next;
+	}
+
+	uint64_t cur_tick() {return _cur_tick;}
+
+	size_t size() {return _size;}
+
+	bool empty() {return _size == 0;}
+
+	static void init_head(TimerNode* head) {
+		head->prev = head->next = head;
+	}
+
+	static void unlink(TimerNode* node) {
+		node->prev->next = node->next;
+		node->next->prev = node->prev;
+		node->prev = node->next = NULL;
+	}
+
+private:
+	void place(TimerNode* node) {
+		if (node->expire_tick <= _cur_tick) {
+			link(&_due, node);
+			return ;
+		}
+		auto delta = node->expire_tick - _cur_tick;
+		auto tick = node->expire_tick;
+		int level = 0;
+		while (level < LEVEL_COUNT - 1 && delta >= (1ULL << ((level + 1) * LEVEL_BITS))) {
+			level++;
+		}
+		// 超出覆盖范围的先挂在最高层最远的槽位
+		auto range = 1ULL << (LEVEL_COUNT * LEVEL_BITS);
+		if (delta >= range) {
+			tick = _cur_tick + range - 1;
+		}
+		auto slot = (int)((tick >> (level * LEVEL_BITS)) & (LEVEL_SLOTS - 1));
+		link(&_slots[level][slot], node);
+		_bitmap[level][slot / 64] |= 1ULL << (slot % 64);
+	}
+
+	// 当前tick处于第level层边界时，将该层对应槽位的节点重新放置到更低层
+	void cascade() {
+		for (int level = 1; level < LEVEL_COUNT; level++) {
+			auto shift = level * LEVEL_BITS;
+			if (_cur_tick & ((1ULL << shift) - 1)) {
+				break ;
+			}
+			auto slot = (int)((_cur_tick >> shift) & (LEVEL_SLOTS - 1));
+			TimerNode list;
+			init_head(&list);
+			move_all(&_slots[level][slot], &list);
+			while (list.next != &list) {
+				auto node = list.next;
+				unlink(node);
+				place(node);
+			}
+		}
+	}
+
+	// 从start起循环查找第一个非空槽，返回距离，无则返回-1
+	int find_slot(int level, int start) {
+		for (int i = 0; i < LEVEL_SLOTS / 64 + 1; i++) {
+			auto word = (start / 64 + i) % (LEVEL_SLOTS / 64);
+			auto bits = _bitmap[level][word];
+			if (i == 0) {
+				bits &= ~0ULL << (start % 64);
+			} else if (i == LEVEL_SLOTS / 64) {
+				bits &= (start % 64) ? ~(~0ULL << (start % 64)) : 0;
+			}
+			if (bits) {
+				auto slot = word * 64 + __builtin_ctzll(bits);
+				return (slot - start + LEVEL_SLOTS) % LEVEL_SLOTS;
+			}
+		}
+		return -1;
+	}
+
+	void link(TimerNode* head, TimerNode* node) {
+		node->prev = head->prev;
+		node->next = head;
+		head->prev->next = node;
+		head->prev = node;
+	}
+
+	// 整条链表拼接到dst尾部，槽位取空后清除位图
+	void move_all(TimerNode* src, TimerNode* dst) {
+		if (src->next == src) {
+			return ;
+		}
+		src->next->prev = dst->prev;
+		dst->prev->next = src->next;
+		src->prev->next = dst;
+		dst->prev = src->prev;
+		init_head(src);
+		clear_bit(src);
+	}
+
+	// head不是槽位哨兵时忽略
+	void clear_bit(TimerNode* head) {
+		if (head < &_slots[0][0] || head >= &_slots[0][0] + LEVEL_COUNT * LEVEL_SLOTS) {
+			return ;
+		}
+		auto index = (int)(head - &_slots[0][0]);
+		auto level = index / LEVEL_SLOTS;
+		auto slot = index % LEVEL_SLOTS;
+		_bitmap[level][slot / 64] &= ~(1ULL << (slot % 64));
+	}
+
+private:
+	uint64_t	_cur_tick;
+	size_t		_size;
+
+	TimerNode	_slots[LEVEL_COUNT][LEVEL_SLOTS];
+	uint64_t	_bitmap[LEVEL_COUNT][LEVEL_SLOTS / 64];
+
+	// expire_tick已过的节点
+	TimerNode	_due;
+};
+
+#endif